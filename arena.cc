@@ -4,14 +4,11 @@
 #include <cstddef>
 
 #include "etl/assert.h"
-#include "etl/mem/arena.h"
 
 using std::uint8_t;
 using std::uintptr_t;
 using std::size_t;
 
-using etl::data::RangePtr;
-
 namespace vga {
 
 extern "C" {
@@ -19,44 +16,128 @@ extern "C" {
   extern uint8_t _sram112_arena_start, _sram112_arena_end;
 }
 
-using Arena = etl::mem::Arena<
-  etl::mem::ReturnNullptrOnAllocationFailure,
-  etl::mem::DoNotRequireDeallocation
->;
+/*
+ * A region of RAM from which we allocate by bumping a pointer.  We keep our
+ * own, rather than using etl::mem::Arena, so that we can roll the pointer back
+ * to a mark.
+ */
+struct Region {
+  char const *name;
+  // Placement requirements (ArenaPlacement::dma, bitband) this region meets.
+  unsigned capabilities;
+  uint8_t *start;
+  uint8_t *end;
+  uint8_t *next;
+  uint8_t *high_water;
+
+  size_t bytes_used() const { return size_t(next - start); }
+  size_t bytes_free() const { return size_t(end - next); }
+};
 
-static Arena ccm_arena({&_ccm_arena_start, &_ccm_arena_end});
-static Arena sram112_arena({&_sram112_arena_start, &_sram112_arena_end});
+// Allocations are rounded up to this, which suits any type we use.
+static constexpr size_t alignment = 8;
 
 /*
  * This serves as a *prioritized* search list, so allocations will be made from
- * the first arena that fits.  We prioritize CCM over the SRAM112 bank because
+ * the first region that fits.  We prioritize CCM over the SRAM112 bank because
  * it's smaller, so we exhaust it preferentially to leave room for large
  * buffers.
  */
-static constexpr Arena * arenas[] = { &ccm_arena, &sram112_arena };
+static Region regions[arena_region_count] = {
+  { "CCM",
+    0,
+    &_ccm_arena_start, &_ccm_arena_end,
+    &_ccm_arena_start, &_ccm_arena_start },
+  { "SRAM112",
+    unsigned(ArenaPlacement::dma | ArenaPlacement::bitband),
+    &_sram112_arena_start, &_sram112_arena_end,
+    &_sram112_arena_start, &_sram112_arena_start },
+};
+
+static uint8_t *align_up(uint8_t *p) {
+  auto addr = reinterpret_cast<uintptr_t>(p);
+  return reinterpret_cast<uint8_t *>((addr + alignment - 1) & ~(alignment - 1));
+}
 
 void arena_reset() {
-  for (auto a : arenas) a->reset();
+  for (auto &r : regions) {
+    r.next = r.high_water = align_up(r.start);
+  }
 }
 
 size_t arena_bytes_free() {
   size_t total = 0;
-  for (auto a : arenas) total += a->get_free_count();
+  for (auto const &r : regions) total += r.bytes_free();
   return total;
 }
 
 size_t arena_bytes_total() {
   size_t total = 0;
-  for (auto a : arenas) total += a->get_total_count();
+  for (auto const &r : regions) total += size_t(r.end - r.start);
   return total;
 }
 
-void * arena_alloc(size_t bytes) {
-  for (auto a : arenas) {
-    auto p = a->allocate(bytes);
-    if (p) return p;
+void * arena_alloc(size_t bytes, ArenaPlacement placement) {
+  bytes = (bytes + alignment - 1) & ~(alignment - 1);
+
+  unsigned const required = unsigned(placement)
+      & unsigned(ArenaPlacement::dma | ArenaPlacement::bitband);
+  bool const reverse = unsigned(placement)
+      & unsigned(ArenaPlacement::prefer_sram);
+
+  for (unsigned i = 0; i < arena_region_count; ++i) {
+    auto &r = regions[reverse ? arena_region_count - 1 - i : i];
+    if ((r.capabilities & required) != required) continue;
+
+    if (r.bytes_free() >= bytes) {
+      void *p = r.next;
+      r.next += bytes;
+      if (r.next > r.high_water) r.high_water = r.next;
+      return p;
+    }
   }
   ETL_ASSERT(false);
 }
 
+ArenaMark arena_mark() {
+  ArenaMark m;
+  for (unsigned i = 0; i < arena_region_count; ++i) {
+    m.used[i] = regions[i].bytes_used();
+  }
+  return m;
+}
+
+void arena_rollback(ArenaMark const &m) {
+  for (unsigned i = 0; i < arena_region_count; ++i) {
+    auto &r = regions[i];
+    // A mark from before the last reset or rollback is meaningless.
+    ETL_ASSERT(m.used[i] <= r.bytes_used());
+    r.next = r.start + m.used[i];
+  }
+}
+
+ArenaRegionStats arena_get_region_stats(unsigned index) {
+  ETL_ASSERT(index < arena_region_count);
+  auto const &r = regions[index];
+  return {
+    .name = r.name,
+    .bytes_total = size_t(r.end - r.start),
+    .bytes_used = r.bytes_used(),
+    .bytes_free = r.bytes_free(),
+    // Free space in a region is never fragmented, but allocations are rounded
+    // up.
+    .largest_block = r.bytes_free() & ~(alignment - 1),
+    .high_water = size_t(r.high_water - r.start),
+  };
+}
+
+size_t arena_largest_block() {
+  size_t largest = 0;
+  for (unsigned i = 0; i < arena_region_count; ++i) {
+    auto n = arena_get_region_stats(i).largest_block;
+    if (n > largest) largest = n;
+  }
+  return largest;
+}
+
 }  // namespace vga
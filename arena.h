@@ -26,11 +26,115 @@ std::size_t arena_bytes_total();
  */
 std::size_t arena_bytes_free();
 
+/*
+ * How big is the largest single allocation that would currently succeed, in
+ * bytes?
+ */
+std::size_t arena_largest_block();
+
+/*
+ * The arena is made up of separate regions of RAM -- CCM and SRAM112 -- which
+ * are searched in that order for each allocation, unless ArenaPlacement (below)
+ * says otherwise.
+ */
+static constexpr unsigned arena_region_count = 2;
+
+/*
+ * Statistics for one region of the arena.
+ */
+struct ArenaRegionStats {
+  char const *name;
+  std::size_t bytes_total;
+  std::size_t bytes_used;
+  std::size_t bytes_free;
+  // Size of the largest allocation this region could satisfy.
+  std::size_t largest_block;
+  // Greatest bytes_used since the last arena_reset, including space since
+  // released by arena_rollback.
+  std::size_t high_water;
+};
+
+/*
+ * Returns statistics for the given region, in [0, arena_region_count).
+ */
+ArenaRegionStats arena_get_region_stats(unsigned index);
+
+/*
+ * A checkpoint in the arena's allocation history.  See arena_mark.
+ */
+struct ArenaMark {
+  std::size_t used[arena_region_count];
+};
+
+/*
+ * Records the current state of the arena, so that everything allocated after
+ * this point can later be released with arena_rollback.
+ */
+ArenaMark arena_mark();
+
+/*
+ * Releases everything allocated since the given mark was taken, implicitly
+ * destroying those objects.  As with arena_reset, destructors are not called!
+ * Marks taken after this one become invalid.
+ *
+ * This lets an application keep long-lived objects at the bottom of the arena
+ * and replace, say, the rasterizer for one band without rebuilding the rest.
+ * Be sure the driver has stopped using any rasterizers being released (see
+ * clear_band_list).
+ */
+void arena_rollback(ArenaMark const &);
+
+/*
+ * A sub-arena lasting for a C++ scope: takes a mark on construction, and rolls
+ * back to it on destruction.  Scopes must be properly nested.
+ *
+ * The arena is a stack, not a heap, so a scope doesn't own particular
+ * allocations: on exit it releases *everything* allocated since it opened, in
+ * every region, by any code -- including objects the scope's body handed to
+ * code outside it.  Anything meant to outlive the scope must be allocated
+ * before it opens.
+ *
+ * Calling arena_reset, or rolling back to an earlier mark, inside a scope
+ * invalidates it, and its destructor will assert (unless nothing had been
+ * allocated when it opened).
+ */
+class ArenaScope {
+public:
+  ArenaScope() : _mark(arena_mark()) {}
+  ~ArenaScope() { arena_rollback(_mark); }
+
+  ArenaScope(ArenaScope const &) = delete;
+  ArenaScope & operator=(ArenaScope const &) = delete;
+
+private:
+  ArenaMark _mark;
+};
+
+/*
+ * Requirements and preferences for where an allocation lands.  Combine with |.
+ */
+enum class ArenaPlacement : unsigned {
+  // No constraints: CCM first, then SRAM112.
+  any = 0,
+  // Must be reachable by the DMA controllers.  (CCM isn't.)
+  dma = 1 << 0,
+  // Must be in the SRAM bit-band region, for Graphics1's fast paths.
+  bitband = 1 << 1,
+  // Try SRAM112 before CCM, keeping CCM free for CPU-only data that's hotter.
+  prefer_sram = 1 << 2,
+};
+
+constexpr ArenaPlacement operator|(ArenaPlacement a, ArenaPlacement b) {
+  return ArenaPlacement(unsigned(a) | unsigned(b));
+}
+
 /*
  * Fundamental allocation primitive; you probably don't want to use this
  * directly when the templates below are available....
+ *
+ * Allocations that can't be satisfied assert.
  */
-void * arena_alloc(std::size_t);
+void * arena_alloc(std::size_t, ArenaPlacement = ArenaPlacement::any);
 
 /*
  * Equivalent of operator new; constructs a T from arena memory by forwarding
@@ -49,17 +153,32 @@ T * arena_new(Args && ... args) {
   return new(raw) T(etl::forward<Args>(args)...);
 }
 
+/*
+ * Like arena_new, but with placement constraints.
+ */
+template <typename T, typename ... Args>
+T * arena_new(ArenaPlacement placement, Args && ... args) {
+  static_assert(std::is_trivially_destructible<T>::value,
+                "vga::arena_new is only safe to use with types that won't mind "
+                "if their destructor never gets called.");
+
+  void * raw = arena_alloc(sizeof(T), placement);
+  return new(raw) T(etl::forward<Args>(args)...);
+}
+
 /*
  * Equivalent of operator new[]; constructs an array of Ts from arena memory
- * using the default constructor.
+ * using the default constructor, optionally with placement constraints.
  */
 template <typename T>
-T * arena_new_array(std::size_t element_count) {
+T * arena_new_array(std::size_t element_count,
+                    ArenaPlacement placement = ArenaPlacement::any) {
   static_assert(std::is_trivially_destructible<T>::value,
                 "vga::arena_new_array is only safe to use with types that "
                 "won't mind if their destructor never gets called.");
 
-  auto ptr = static_cast<T *>(arena_alloc(sizeof(T) * element_count));
+  auto ptr = static_cast<T *>(arena_alloc(sizeof(T) * element_count,
+                                          placement));
   for (std::size_t i = 0; i < element_count; ++i) {
     new(&ptr[i]) T;
   }
@@ -3,6 +3,10 @@
 #include <cstdint>
 
 #include "etl/algorithm.h"
+#include "etl/utility.h"
+
+#include "vga/copy_words.h"
+#include "vga/shift_words.h"
 
 using etl::min;
 
@@ -15,130 +19,185 @@ static constexpr uint32_t maskbits(unsigned n) {
   return (uint32_t(1) << n) - 1;
 }
 
+// Below this many words, copy_words' setup and teardown (about 40 cycles)
+// costs more than it saves over a simple loop.
+static constexpr unsigned copy_words_threshold = 16;
+
 /*
- * Specialization of bitrow for when both source and dest are word-aligned.
- * This reduces to N word transfers and a final bitfield insert.
+ * Copies bit_count bits from source, starting at bit source_offset of its
+ * first word, to dest, starting at bit dest_offset.  Both offsets are < 32.
+ *
+ * Partial destination words at either end are merged with masks.  Full words
+ * in between come from one of the word-streaming kernels: copy_words if the
+ * source and destination bits line up, and the funnel shift of shift_words
+ * otherwise.  Only source words holding bits of the row are read.
  */
-static void bitrow_aligned(uint32_t const *source,
-                           uint32_t *dest,
-                           unsigned bit_count) {
-  // TODO: should totally use copy_words here.
-  while (bit_count >= 32) {
-    *dest++ = *source++;
-    bit_count -= 32;
+__attribute__((noinline))
+static void bitrow(uint32_t const *source,
+                   unsigned source_offset,
+                   uint32_t *dest,
+                   unsigned dest_offset,
+                   unsigned bit_count) {
+  PRE(source_offset < 32);
+  PRE(dest_offset < 32);
+
+  // Bring dest into alignment, unless it's there already.
+  if (dest_offset) {
+    unsigned bits = min(32 - dest_offset, bit_count);
+    uint32_t s = source[0] >> source_offset;
+    if (source_offset + bits > 32) s |= source[1] << (32 - source_offset);
+    uint32_t m = maskbits(bits) << dest_offset;
+    *dest = (*dest & ~m) | ((s << dest_offset) & m);
+
+    bit_count -= bits;
+    if (bit_count == 0) return;
+
+    source_offset += bits;
+    source += source_offset / 32;
+    source_offset %= 32;
+    ++dest;
+  }
+
+  unsigned words = bit_count / 32;
+  if (words) {
+    if (source_offset) {
+      shift_words(source, dest, words, source_offset);
+    } else if (words >= copy_words_threshold) {
+      copy_words(source, dest, words);
+    } else {
+      for (unsigned i = 0; i < words; ++i) dest[i] = source[i];
+    }
+    source += words;
+    dest += words;
+    bit_count %= 32;
   }
 
   if (bit_count) {
-    uint32_t mask = (1 << bit_count) - 1;
-    *dest = (*dest & ~mask) | (*source & mask);
+    uint32_t s = source[0] >> source_offset;
+    if (source_offset + bit_count > 32) s |= source[1] << (32 - source_offset);
+    uint32_t m = maskbits(bit_count);
+    *dest = (*dest & ~m) | (s & m);
   }
 }
 
-/*
- * Specialization of bitrow for when source and dest are unaligned the same way.
+/*******************************************************************************
+ * General case: raster ops, masks, and overlap.
  */
-static void bitrow_almost_aligned(uint32_t const *source,
-                                  uint32_t *dest,
-                                  unsigned start_bit,
-                                  unsigned bit_count) {
-  PRE(start_bit < 32);
-  unsigned bits = min(32u - start_bit, bit_count);
-  uint32_t mask = maskbits(bits) << start_bit;
-  *dest = (*dest & ~mask) | (*source & mask);
-  
-  bitrow_aligned(source + 1, dest + 1, bit_count - bits);
-}
 
 /*
- * Specialization of bitrow for when only dest is aligned.
+ * Reads 32 bits of a row, starting at the given bit, which may lie a word or
+ * so outside the span [first_word, last_word] that we're allowed to read.
+ * Bits from outside the span are garbage; callers mask them off.
  */
-__attribute__((noinline))
-static void bitrow_dest_aligned(uint32_t const *source,
-                                unsigned source_offset,
-                                uint32_t *dest,
-                                unsigned bit_count) {
-  PRE(source_offset < 32);
+static inline uint32_t fetch_bits(uint32_t const *row,
+                                  int bit,
+                                  int first_word,
+                                  int last_word) {
+  int lo = bit >> 5;  // Arithmetic shift: rounds toward -infinity.
+  unsigned shift = unsigned(bit) & 31;
+  int hi = lo + 1;
 
-  while (bit_count >= 32) {
-    *dest = (source[0] >> source_offset) | (source[1] << (32 - source_offset));
-    ++source;
-    ++dest;
-    bit_count -= 32;
-  }
+  if (lo < first_word) lo = first_word;
+  if (lo > last_word) lo = last_word;
+  if (hi > last_word) hi = last_word;
 
-  if (bit_count) {
-    uint32_t s = source[0] >> source_offset;
-    if (bit_count > 32 - source_offset) {
-      s |= source[1] << (32 - source_offset);
-    }
-    *dest = (*dest & ~maskbits(bit_count)) | (s & maskbits(bit_count));
+  uint32_t bits = row[lo] >> shift;
+  if (shift) bits |= row[hi] << (32 - shift);
+  return bits;
+}
+
+template <RasterOp O>
+static inline uint32_t combine(uint32_t s, uint32_t d) {
+  switch (O) {
+    case RasterOp::copy:      return s;
+    case RasterOp::intersect: return d & s;
+    case RasterOp::set:       return d | s;
+    case RasterOp::toggle:    return d ^ s;
+    case RasterOp::clear:     return d & ~s;
   }
+  return d;
 }
 
 /*
- * Specialization of bitrow for when only source is aligned.
+ * Applies O to one row, a destination word at a time.  Each source (and mask)
+ * word is shifted into alignment with the destination, so the source is read
+ * in full words too.  If backward is set, words are processed right to left,
+ * for overlapping moves to the right.
  */
-static void bitrow_source_aligned(uint32_t const *source,
-                                  uint32_t *dest,
-                                  unsigned dest_offset,
-                                  unsigned bit_count) {
-  PRE(dest_offset < 32);
+template <RasterOp O>
+static void bitrow_op(uint32_t const *source_row, unsigned source_x,
+                      uint32_t const *mask_row, unsigned mask_x,
+                      uint32_t *dest_row, unsigned dest_x,
+                      unsigned width,
+                      bool backward) {
+  int const first = dest_x / 32;
+  int const last = (dest_x + width - 1) / 32;
 
-  while (bit_count >= 32) {
-    uint32_t s = *source++;
-    *dest = (*dest & maskbits(dest_offset)) | (s << dest_offset);
-    dest++;
-    *dest = (*dest & ~maskbits(dest_offset)) | (s >> (32 - dest_offset));
-    bit_count -= 32;
-  }
+  int const source_first = source_x / 32;
+  int const source_last = (source_x + width - 1) / 32;
+  int const mask_first = mask_x / 32;
+  int const mask_last = (mask_x + width - 1) / 32;
 
-  if (bit_count) {
-    uint32_t s = *source & maskbits(bit_count);
-    dest[0] = (dest[0] & maskbits(dest_offset)) | (s << dest_offset);
-    if (bit_count > (32 - dest_offset)) {
-      dest[1] = (dest[1] & ~maskbits(dest_offset)) | (s >> (32 - dest_offset));
+  // Offsets from a destination bit to the corresponding source and mask bits.
+  int const source_delta = int(source_x) - int(dest_x);
+  int const mask_delta = int(mask_x) - int(dest_x);
+
+  uint32_t const first_mask = ~0u << (dest_x % 32);
+  uint32_t const last_mask = ~0u >> (31 - (dest_x + width - 1) % 32);
+
+  int const step = backward ? -1 : 1;
+  for (int w = backward ? last : first; w >= first && w <= last; w += step) {
+    uint32_t m = ~0u;
+    if (w == first) m &= first_mask;
+    if (w == last) m &= last_mask;
+    if (mask_row) {
+      m &= fetch_bits(mask_row, w * 32 + mask_delta, mask_first, mask_last);
     }
+
+    uint32_t s = fetch_bits(source_row, w * 32 + source_delta,
+                            source_first, source_last);
+    uint32_t d = dest_row[w];
+    dest_row[w] = (d & ~m) | (combine<O>(s, d) & m);
   }
 }
 
-__attribute__((noinline))
-static void bitrow(uint32_t const *source,
-                   unsigned source_offset,
-                   uint32_t *dest,
-                   unsigned dest_offset,
-                   unsigned bit_count) {
-  if (source_offset == 0 && dest_offset == 0) {
-    bitrow_aligned(source, dest, bit_count);
-  } else if (source_offset == dest_offset) {
-    bitrow_almost_aligned(source, dest, source_offset, bit_count);
-  } else if (source_offset == 0) {
-    bitrow_source_aligned(source, dest, dest_offset, bit_count);
-  } else if (dest_offset == 0) {
-    bitrow_dest_aligned(source, source_offset, dest, bit_count);
-  } else {
-    // We can align one of the two using a single transfer.  Which?
-    if (source_offset > dest_offset) {
-      unsigned bits_moved = 32 - source_offset;
-      unsigned s = *source >> source_offset;
-      *dest = (*dest & maskbits(dest_offset)) | (s << dest_offset);
-      bitrow_source_aligned(source + 1,
-                            dest, 
-                            dest_offset + bits_moved,
-                            bit_count - bits_moved);
-    } else {  // dest_offset > source_offset
-      unsigned bits_moved = 32 - dest_offset;
-      unsigned s = *source >> source_offset;
-      *dest = (*dest & maskbits(dest_offset)) | (s << dest_offset);
-      bitrow_dest_aligned(source,
-                          source_offset + bits_moved,
-                          dest + 1,
-                          bit_count - bits_moved);
-    }
+template <RasterOp O>
+static void bitblt_op(Bitmap const &source, unsigned source_x,
+                      unsigned source_y,
+                      Bitmap const *mask, unsigned mask_x, unsigned mask_y,
+                      Bitmap const &dest, Bitmap::Block const &dest_blk,
+                      bool backward) {
+  // Row pointers start at word 0 of each row; bitrow_op finds the rest.
+  for (unsigned i = 0; i < dest_blk.height; ++i) {
+    unsigned y = backward ? dest_blk.height - 1 - i : i;
+    bitrow_op<O>(source.word_addr(0, source_y + y), source_x,
+                 mask ? mask->word_addr(0, mask_y + y) : nullptr, mask_x,
+                 dest.word_addr(0, dest_blk.y + y), dest_blk.x,
+                 dest_blk.width,
+                 backward);
   }
 }
 
-void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
-            Bitmap const &dest, Bitmap::Block const &dest_blk) {
+/*
+ * Finds the range of words spanned by a block of a Bitmap, whichever way its
+ * stride runs.
+ */
+static void block_words(Bitmap const &b,
+                        unsigned x, unsigned y,
+                        unsigned width, unsigned height,
+                        uint32_t const **lo, uint32_t const **hi) {
+  auto top = b.word_addr(x, y);
+  auto bottom = b.word_addr(x, y + height - 1);
+  if (bottom < top) etl::swap(top, bottom);
+  *lo = top;
+  *hi = bottom + (x % 32 + width + 31) / 32;
+}
+
+static void bitblt_common(Bitmap const &source,
+                          unsigned source_x, unsigned source_y,
+                          Bitmap const *mask, unsigned mask_x, unsigned mask_y,
+                          Bitmap const &dest, Bitmap::Block const &dest_blk,
+                          RasterOp op) {
   PRE(source_x < source.width_px);
   PRE(source_y < source.height_px);
 
@@ -150,27 +209,81 @@ void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
   PRE(dest_blk.x + dest_blk.width <= dest.width_px);
   PRE(dest_blk.y + dest_blk.height <= dest.height_px);
 
-  // TODO: allow for negative stride.
-  // TODO: enable overlap -- for now we reject it.
-  {
-    auto source_start = source.word_addr(source_x, source_y);
-    auto source_end   = source.word_addr(source_x + dest_blk.width,
-                                         source_y + dest_blk.height);
-
-    auto dest_start = dest.word_addr(dest_blk.x, dest_blk.y);
-    auto dest_end   = dest.word_addr(dest_blk.x + dest_blk.width,
-                                     dest_blk.y + dest_blk.height);
-    
-    PRE(dest_end < source_start || source_end < dest_start);
+  if (mask) {
+    PRE(mask_x + dest_blk.width <= mask->width_px);
+    PRE(mask_y + dest_blk.height <= mask->height_px);
   }
 
-  for (unsigned y = 0; y < dest_blk.height; ++y) {
-    bitrow(source.word_addr(source_x, source_y + y),
-           source_x % 32,
-           dest.word_addr(dest_blk.x, dest_blk.y + y),
-           dest_blk.x % 32,
-           dest_blk.width);
+  if (dest_blk.width == 0 || dest_blk.height == 0) return;
+
+  // Overlap is fine within a single Bitmap, where we can pick an order that
+  // reads each source pixel before overwriting it -- as memmove does, but in
+  // two dimensions.  Between different Bitmaps, we reject it.
+  bool same = source.base == dest.base
+           && source.stride_words == dest.stride_words;
+  bool backward = same
+      && (dest_blk.y > source_y
+          || (dest_blk.y == source_y && dest_blk.x > source_x));
+
+  if (!same) {
+    uint32_t const *source_lo, *source_hi, *dest_lo, *dest_hi;
+    block_words(source, source_x, source_y, dest_blk.width, dest_blk.height,
+                &source_lo, &source_hi);
+    block_words(dest, dest_blk.x, dest_blk.y, dest_blk.width, dest_blk.height,
+                &dest_lo, &dest_hi);
+    PRE(dest_hi <= source_lo || source_hi <= dest_lo);
+  }
+
+  // Plain copies without overlap take the specialized path below.
+  bool overlap = same
+      && dest_blk.y < source_y + dest_blk.height
+      && source_y < dest_blk.y + dest_blk.height;
+  if (op == RasterOp::copy && !mask && !overlap) {
+    for (unsigned y = 0; y < dest_blk.height; ++y) {
+      bitrow(source.word_addr(source_x, source_y + y),
+             source_x % 32,
+             dest.word_addr(dest_blk.x, dest_blk.y + y),
+             dest_blk.x % 32,
+             dest_blk.width);
+    }
+    return;
   }
+
+  switch (op) {
+#define BITBLT_CASE(o) \
+    case RasterOp::o: \
+      bitblt_op<RasterOp::o>(source, source_x, source_y, \
+                             mask, mask_x, mask_y, \
+                             dest, dest_blk, backward); \
+      break;
+
+    BITBLT_CASE(copy)
+    BITBLT_CASE(intersect)
+    BITBLT_CASE(set)
+    BITBLT_CASE(toggle)
+    BITBLT_CASE(clear)
+
+#undef BITBLT_CASE
+  }
+}
+
+void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
+            Bitmap const &dest, Bitmap::Block const &dest_blk,
+            RasterOp op) {
+  bitblt_common(source, source_x, source_y,
+                nullptr, 0, 0,
+                dest, dest_blk,
+                op);
+}
+
+void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
+            Bitmap const &mask, unsigned mask_x, unsigned mask_y,
+            Bitmap const &dest, Bitmap::Block const &dest_blk,
+            RasterOp op) {
+  bitblt_common(source, source_x, source_y,
+                &mask, mask_x, mask_y,
+                dest, dest_blk,
+                op);
 }
 
 }  // namespace vga
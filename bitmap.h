@@ -11,9 +11,10 @@ struct Bitmap {
   unsigned height_px;
   int stride_words;
 
+  // stride_words may be negative, for bitmaps stored bottom-up.
   etl::armv7m::Word *word_addr(unsigned x, unsigned y) const {
     auto b = static_cast<etl::armv7m::Word *>(base);
-    return &b[y * stride_words + x/32];
+    return &b[int(y) * stride_words + int(x/32)];
   }
 
   struct Block {
@@ -25,8 +26,39 @@ struct Bitmap {
 
 };
 
+/*
+ * How bitblt combines each source pixel s with the destination pixel d.
+ */
+enum class RasterOp {
+  copy,       // s
+  intersect,  // d & s   -- keep only what's in both
+  set,        // d | s   -- draw the source's 1s
+  toggle,     // d ^ s   -- e.g. for cursors that remove themselves
+  clear,      // d & ~s  -- erase the source's 1s
+};
+
+/*
+ * Combines a block of pixels, starting at (source_x, source_y) in source, into
+ * dest_blk in dest.  The block must lie within both Bitmaps.
+ *
+ * Source and dest may be the same Bitmap, with overlapping blocks, e.g. to
+ * scroll in place; the copy is carried out in whichever order gives the right
+ * result.  Otherwise they must not overlap in memory.
+ */
+void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
+            Bitmap const &dest, Bitmap::Block const &dest_blk,
+            RasterOp op = RasterOp::copy);
+
+/*
+ * Like bitblt above, but only pixels where the corresponding pixel of mask --
+ * starting at (mask_x, mask_y) -- is 1 are affected.  The rest of dest_blk is
+ * left alone.  mask may be any Bitmap, including source, as long as it doesn't
+ * overlap the destination block.
+ */
 void bitblt(Bitmap const &source, unsigned source_x, unsigned source_y,
-            Bitmap const &dest, Bitmap::Block const &dest_blk);
+            Bitmap const &mask, unsigned mask_x, unsigned mask_y,
+            Bitmap const &dest, Bitmap::Block const &dest_blk,
+            RasterOp op = RasterOp::copy);
 
 }  // namespace vga
 
@@ -0,0 +1,49 @@
+#include "vga/blit_keyed.h"
+
+// C++ versions of the routines in blit_keyed.S.
+
+using etl::armv7m::Byte;
+using etl::armv7m::Word;
+
+void blit_words_keyed_reference(Byte const *source,
+                                Word *dest,
+                                Word count,
+                                Word key) {
+  auto out = reinterpret_cast<Byte *>(dest);
+  Byte k = Byte(key);
+  for (Word i = 0; i < count * 4; ++i) {
+    if (source[i] != k) out[i] = source[i];
+  }
+}
+
+void blit_words_blended_reference(Byte const *source,
+                                  Word *dest,
+                                  Word count,
+                                  BlendParams const *params) {
+  auto out = reinterpret_cast<Byte *>(dest);
+  Byte k = Byte(params->key);
+  Word bits = params->bits;
+  Word mask = (Word(1) << bits) - 1;
+  for (Word i = 0; i < count * 4; ++i) {
+    Byte s = source[i];
+    if (s != k) out[i] = params->table[((s & mask) << bits) | (out[i] & mask)];
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void blit_words_keyed(Byte const *source,
+                      Word *dest,
+                      Word count,
+                      Word key) {
+  blit_words_keyed_reference(source, dest, count, key);
+}
+
+void blit_words_blended(Byte const *source,
+                        Word *dest,
+                        Word count,
+                        BlendParams const *params) {
+  blit_words_blended_reference(source, dest, count, params);
+}
+
+#endif  // __ARM_PCS_VFP
@@ -0,0 +1,56 @@
+#ifndef BLIT_KEYED_H
+#define BLIT_KEYED_H
+
+#include "etl/armv7m/types.h"
+
+/*
+ * Copies count words' worth of 8bpp pixels from source to dest, except for
+ * source pixels equal to the color key, which leave the destination pixel
+ * alone.  key holds the key color replicated into all four bytes.
+ *
+ * dest must be word-aligned; source needn't be.
+ */
+void blit_words_keyed(etl::armv7m::Byte const *source,
+                      etl::armv7m::Word *dest,
+                      etl::armv7m::Word count,
+                      etl::armv7m::Word key);
+
+/*
+ * Parameters for blit_words_blended.
+ */
+struct BlendParams {
+  // Blend lookup table of 2^(2 * bits) entries, indexed by
+  // (source << bits) | dest, using the low bits of each pixel.
+  etl::armv7m::Byte const *table;
+  // Key color, replicated into all four bytes.
+  etl::armv7m::Word key;
+  // Bits per color index in the table: 8 or 6.
+  etl::armv7m::Word bits;
+};
+
+/*
+ * Like blit_words_keyed, but rather than replacing destination pixels, each
+ * source pixel is combined with the destination pixel by lookup in the blend
+ * table.  Source pixels equal to the key still leave the destination alone.
+ */
+void blit_words_blended(etl::armv7m::Byte const *source,
+                        etl::armv7m::Word *dest,
+                        etl::armv7m::Word count,
+                        BlendParams const *params);
+
+/*
+ * Portable implementations of the two blits above, available on every
+ * architecture so that the assembly versions can be checked and benchmarked
+ * against them.
+ */
+void blit_words_keyed_reference(etl::armv7m::Byte const *source,
+                                etl::armv7m::Word *dest,
+                                etl::armv7m::Word count,
+                                etl::armv7m::Word key);
+
+void blit_words_blended_reference(etl::armv7m::Byte const *source,
+                                  etl::armv7m::Word *dest,
+                                  etl::armv7m::Word count,
+                                  BlendParams const *params);
+
+#endif  // BLIT_KEYED_H
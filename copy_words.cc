@@ -0,0 +1,23 @@
+#include "vga/copy_words.h"
+
+// C++ version of copy_words.S.
+
+using etl::armv7m::Word;
+
+void copy_words_reference(Word const *source,
+                          Word *dest,
+                          Word count) {
+  while (count--) {
+    *dest++ = *source++;
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void copy_words(Word const *source,
+                Word *dest,
+                Word count) {
+  copy_words_reference(source, dest, count);
+}
+
+#endif  // __ARM_PCS_VFP
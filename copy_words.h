@@ -10,4 +10,12 @@ void copy_words(etl::armv7m::Word const *source,
                 etl::armv7m::Word *dest,
                 etl::armv7m::Word count);
 
+/*
+ * Portable implementation of copy_words, available on every architecture so
+ * that the assembly version can be checked and benchmarked against it.
+ */
+void copy_words_reference(etl::armv7m::Word const *source,
+                          etl::armv7m::Word *dest,
+                          etl::armv7m::Word count);
+
 #endif  // COPY_WORDS_H
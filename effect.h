@@ -0,0 +1,87 @@
+#ifndef VGA_EFFECT_H
+#define VGA_EFFECT_H
+
+#include <cstdint>
+
+#include "vga/vga.h"
+
+/*
+ * Raster effects: changes to rasterizer state -- a palette entry, a color, a
+ * scroll offset -- made at a particular line, for gradients, color splits, and
+ * the like.
+ *
+ * Effects are attached to a Band as an array sorted by line, and applied by
+ * the driver immediately before it rasterizes the line in question.  Because
+ * rasterization runs ahead of scanout, an effect must only change state that's
+ * read during rasterize -- which is all of it, for the rasterizers in rast/.
+ * Changing state directly from vga_hblank_interrupt would take effect a few
+ * lines early, by contrast.
+ *
+ * A rasterizer never repeats a line across an effect, so every line with an
+ * effect is rasterized afresh.  If the driver must skip lines (see
+ * OverrunPolicy), their effects are applied late, rather than not at all; any
+ * effects left over at the end of a band are applied as the band ends.
+ *
+ * Effects stay in force until changed: to get the same picture every frame,
+ * have an effect on the band's first line put things back.
+ *
+ * Effects run in the driver's interrupt context, so apply functions should be
+ * brief, and preferably in RAM.
+ */
+
+namespace vga {
+
+struct Effect {
+  // Line within the band, counting from zero, before which to apply.
+  unsigned line;
+  void (*apply)(void *object, std::uintptr_t value);
+  void *object;
+  std::uintptr_t value;
+};
+
+namespace effect_detail {
+
+template <typename T>
+__attribute__((section(".ramcode")))
+void store(void *object, std::uintptr_t value) {
+  *static_cast<T *>(object) = (T) value;
+}
+
+template <typename T, typename A, void (T::*method)(A)>
+__attribute__((section(".ramcode")))
+void call(void *object, std::uintptr_t value) {
+  (static_cast<T *>(object)->*method)((A) value);
+}
+
+}  // namespace effect_detail
+
+/*
+ * Makes an Effect that stores value at *where -- for example, to rewrite a
+ * palette entry:
+ *
+ *   store_effect(100, &palette8.get_palette()[3], Pixel(0x30))
+ */
+template <typename T>
+inline Effect store_effect(unsigned line, T *where, T value) {
+  return { line, &effect_detail::store<T>, where, (std::uintptr_t) value };
+}
+
+/*
+ * Makes an Effect that calls a one-argument setter on object -- for example:
+ *
+ *   call_effect<rast::SolidColor, Pixel, &rast::SolidColor::set_color>(
+ *       100, solid_color, 0x30)
+ */
+template <typename T, typename A, void (T::*method)(A)>
+inline Effect call_effect(unsigned line, T &object, A value) {
+  return {
+    line,
+    &effect_detail::call<T, A, method>,
+    &object,
+    (std::uintptr_t) value,
+  };
+}
+
+}  // namespace vga
+
+#endif  // VGA_EFFECT_H
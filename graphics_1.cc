@@ -1,5 +1,7 @@
 #include "vga/graphics_1.h"
 
+#include <cstdint>
+
 #include "etl/prediction.h"
 #include "etl/utility.h"
 
@@ -11,17 +13,32 @@ namespace vga {
  * Basics: construction, pixel access, memory geometry.
  */
 
+static bool is_bitband(void const *p) {
+  auto addr = reinterpret_cast<uintptr_t>(p);
+  return (addr >= 0x20000000 && addr < 0x20100000)
+      || (addr < 0x100000);
+}
+
 Graphics1::Graphics1(Bitmap b)
-  : _b(b) {}
+  : _b(b),
+    _bitband(is_bitband(b.base)) {}
 
 void Graphics1::set_pixel(unsigned x, unsigned y) {
   if (x >= _b.width_px || y >= _b.height_px) return;
-  *bit_addr(x, y) = 1;
+  if (_bitband) {
+    *bit_addr(x, y) = 1;
+  } else {
+    *word_addr(x, y) |= 1u << (x % 32);
+  }
 }
 
 void Graphics1::clear_pixel(unsigned x, unsigned y) {
   if (x >= _b.width_px || y >= _b.height_px) return;
-  *bit_addr(x, y) = 0;
+  if (_bitband) {
+    *bit_addr(x, y) = 0;
+  } else {
+    *word_addr(x, y) &= ~(1u << (x % 32));
+  }
 }
 
 RAMCODE("Graphics1.word_addr")
@@ -32,10 +49,11 @@ unsigned *Graphics1::word_addr(unsigned x, unsigned y) {
 
 RAMCODE("Graphics1.bit_addr")
 unsigned *Graphics1::bit_addr(unsigned x, unsigned y) {
-  unsigned offset = reinterpret_cast<unsigned>(_b.base);
-  unsigned bit_base = offset * 32 + 0x22000000;
+  auto offset = std::uint32_t(reinterpret_cast<std::uintptr_t>(_b.base));
+  std::uint32_t bit_base = offset * 32 + 0x22000000;
 
-  return reinterpret_cast<unsigned *>(bit_base) + y * _b.width_px + x;
+  return reinterpret_cast<unsigned *>(std::uintptr_t(bit_base))
+       + y * _b.width_px + x;
 }
 
 RAMCODE("Graphics1.clear_all")
@@ -98,6 +116,11 @@ inline void Graphics1::draw_line_unclipped_spec(unsigned *out,
 
 template <bool S>
 inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
+  if (!_bitband) {
+    draw_line_unclipped_words<S>(x0, y0, x1, y1);
+    return;
+  }
+
   // We only draw horizontal or downward lines.  Ensure this:
   if (y0 > y1) {
     etl::swap(x0, x1);
@@ -109,11 +132,15 @@ inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
 
   unsigned *out = bit_addr(x0, y0);
 
+  // The special cases below draw the same pixels as the general case -- both
+  // endpoints included -- just faster.  The word-at-a-time path relies on
+  // that.
+
   if (ETL_UNLIKELY(dx == 0)) {
     // Vertical line.
     // Note that dy is nonnegative.
     int step = _b.width_px;
-    while (dy--) {
+    for (int i = 0; i <= dy; ++i) {
       *out = S;
       out += step;
     }
@@ -123,9 +150,11 @@ inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
   if (ETL_UNLIKELY(dy == 0)) {
     // Horizontal line.
     int step = dx > 0 ? 1 : -1;
-    while (dx -= step) {
-      *out = S;
+    *out = S;
+    while (dx) {
+      dx -= step;
       out += step;
+      *out = S;
     }
     return;
   }
@@ -133,7 +162,7 @@ inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
   if (ETL_UNLIKELY(dy == dx)) {
     // Diagonal line to lower left.
     int step = _b.width_px + 1;
-    while (dy--) {
+    for (int i = 0; i <= dy; ++i) {
       *out = S;
       out += step;
     }
@@ -143,7 +172,7 @@ inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
   if (ETL_UNLIKELY(dy == -dx)) {
     // Diagonal line to lower right.
     int step = _b.width_px - 1;
-    while (dy--) {
+    for (int i = 0; i <= dy; ++i) {
       *out = S;
       out += step;
     }
@@ -166,6 +195,71 @@ inline void Graphics1::draw_line_unclipped(int x0, int y0, int x1, int y1) {
   }
 }
 
+/*
+ * The same algorithm as draw_line_unclipped_spec, for framebuffers outside the
+ * bit-band region.  We track the current pixel as a word and a bit mask, and
+ * collect pixels in the same word -- as happens along mostly-horizontal lines
+ * -- so that each word costs a single read-modify-write.
+ */
+template <bool S>
+inline void Graphics1::draw_line_unclipped_words(int x0, int y0,
+                                                 int x1, int y1) {
+  if (y0 > y1) {
+    etl::swap(x0, x1);
+    etl::swap(y0, y1);
+  }
+
+  int dx = x1 - x0;
+  int dy = y1 - y0;
+  int x_adv = dx < 0 ? -1 : 1;
+  if (dx < 0) dx = -dx;
+
+  bool horizontal = dx > dy;
+  int dmajor = horizontal ? dx : dy;
+  int dminor = horizontal ? dy : dx;
+
+  int dminor2 = dminor * 2;
+  int dmajor2 = dmajor * 2;
+  int error = dminor2 - dmajor;
+
+  unsigned *word = word_addr(x0, y0);
+  unsigned bit = 1u << (x0 % 32);
+  unsigned pending = bit;
+
+  auto flush = [&] {
+    if (pending) {
+      if (S) *word |= pending; else *word &= ~pending;
+      pending = 0;
+    }
+  };
+
+  auto step_x = [&] {
+    bit = x_adv > 0 ? bit << 1 : bit >> 1;
+    if (!bit) {
+      flush();
+      word += x_adv;
+      bit = x_adv > 0 ? 1u : 1u << 31;
+    }
+  };
+
+  auto step_y = [&] {
+    flush();
+    word += _b.stride_words;
+  };
+
+  while (dmajor--) {
+    if (error >= 0) {
+      if (horizontal) step_y(); else step_x();
+      error -= dmajor2;
+    }
+    error += dminor2;
+    if (horizontal) step_x(); else step_y();
+    pending |= bit;
+  }
+
+  flush();
+}
+
 /*
  * We only expose the unclipped version to users in this one flavor:
  */
@@ -293,6 +387,121 @@ void Graphics1::clear_line(int x1, int y1, int x2, int y2) {
   draw_line_spec<false>(x1, y1, x2, y2);
 }
 
+/*******************************************************************************
+ * Word-parallel spans and rectangles.
+ */
+
+enum class Graphics1::Op {
+  set,
+  clear,
+  invert,
+};
+
+/*
+ * Applies an Op to the pixels of a word selected by mask.  This compiles down
+ * to a single ORR, BIC, or EOR.
+ */
+template <Graphics1::Op O>
+inline void Graphics1::apply(unsigned &word, unsigned mask) {
+  switch (O) {
+    case Op::set:    word |= mask;  break;
+    case Op::clear:  word &= ~mask; break;
+    case Op::invert: word ^= mask;  break;
+  }
+}
+
+/*
+ * The meat of the span and rectangle operations, covering pixels [x1, x2) on
+ * lines [y1, y2), after clipping.  Pixel x lives in bit x % 32 of word x / 32.
+ */
+template <Graphics1::Op O>
+inline void Graphics1::rect_spec(int x1, int y1, int x2, int y2) {
+  if (x1 < 0) x1 = 0;
+  if (y1 < 0) y1 = 0;
+  if (x2 > int(_b.width_px)) x2 = _b.width_px;
+  if (y2 > int(_b.height_px)) y2 = _b.height_px;
+  if (x1 >= x2 || y1 >= y2) return;
+
+  unsigned first = unsigned(x1) / 32;
+  unsigned last = unsigned(x2 - 1) / 32;
+  unsigned first_mask = ~0u << (unsigned(x1) % 32);
+  unsigned last_mask = ~0u >> (31 - unsigned(x2 - 1) % 32);
+
+  if (first == last) first_mask = last_mask = first_mask & last_mask;
+
+  for (int y = y1; y < y2; ++y) {
+    unsigned *row = word_addr(0, y);
+
+    apply<O>(row[first], first_mask);
+    if (first == last) continue;
+
+    for (unsigned i = first + 1; i < last; ++i) {
+      // Whole words: no need to read them, unless inverting.
+      switch (O) {
+        case Op::set:    row[i] = ~0u; break;
+        case Op::clear:  row[i] = 0;   break;
+        case Op::invert: row[i] = ~row[i]; break;
+      }
+    }
+
+    apply<O>(row[last], last_mask);
+  }
+}
+
+template <Graphics1::Op O>
+inline void Graphics1::rect_outline_spec(int x, int y, int width, int height) {
+  if (width <= 0 || height <= 0) return;
+
+  int x2 = x + width, y2 = y + height;
+  rect_spec<O>(x, y, x2, y + 1);
+  if (height > 1) rect_spec<O>(x, y2 - 1, x2, y2);
+  if (height > 2) {
+    rect_spec<O>(x, y + 1, x + 1, y2 - 1);
+    if (width > 1) rect_spec<O>(x2 - 1, y + 1, x2, y2 - 1);
+  }
+}
+
+RAMCODE("Graphics1.set_span")
+void Graphics1::set_span(int x1, int x2, int y) {
+  rect_spec<Op::set>(x1, y, x2, y + 1);
+}
+
+RAMCODE("Graphics1.clear_span")
+void Graphics1::clear_span(int x1, int x2, int y) {
+  rect_spec<Op::clear>(x1, y, x2, y + 1);
+}
+
+RAMCODE("Graphics1.invert_span")
+void Graphics1::invert_span(int x1, int x2, int y) {
+  rect_spec<Op::invert>(x1, y, x2, y + 1);
+}
+
+RAMCODE("Graphics1.set_rect")
+void Graphics1::set_rect(int x, int y, int width, int height) {
+  rect_spec<Op::set>(x, y, x + width, y + height);
+}
+
+RAMCODE("Graphics1.clear_rect")
+void Graphics1::clear_rect(int x, int y, int width, int height) {
+  rect_spec<Op::clear>(x, y, x + width, y + height);
+}
+
+RAMCODE("Graphics1.invert_rect")
+void Graphics1::invert_rect(int x, int y, int width, int height) {
+  rect_spec<Op::invert>(x, y, x + width, y + height);
+}
+
+RAMCODE("Graphics1.set_rect_outline")
+void Graphics1::set_rect_outline(int x, int y, int width, int height) {
+  rect_outline_spec<Op::set>(x, y, width, height);
+}
+
+RAMCODE("Graphics1.clear_rect_outline")
+void Graphics1::clear_rect_outline(int x, int y, int width, int height) {
+  rect_outline_spec<Op::clear>(x, y, width, height);
+}
+
+
 /*******************************************************************************
  * Floating point coordinate support.
  */
@@ -8,7 +8,10 @@ namespace vga {
 /*
  * Provides primitive graphics operations on a 1bpp raster framebuffer.
  *
- * Requires the framebuffer to be in bitband-capable memory, for performance.
+ * Pixels and lines are fastest with the framebuffer in bitband-capable memory,
+ * where each pixel is a single store.  Elsewhere (e.g. CCM), Graphics1 falls
+ * back on read-modify-write of whole words, chosen automatically from the
+ * Bitmap's address.
  */
 class Graphics1 {
 public:
@@ -51,8 +54,8 @@ public:
 
   /*
    * Draws a line from (x1, y1) to (x2, y2), setting pixels along the line to
-   * the foreground color.  Any portion of the line outside the Bitmap's bounds
-   * is left undrawn.
+   * the foreground color.  Both endpoints are drawn.  Any portion of the line
+   * outside the Bitmap's bounds is left undrawn.
    */
   void set_line(int x1, int y1, int x2, int y2);
 
@@ -87,8 +90,61 @@ public:
     }
   }
 
+  /*
+   * Span and rectangle operations.  These work a word (32 pixels) at a time,
+   * with masked writes at the ends, so they're much faster than drawing pixel
+   * by pixel -- and they don't need bit-band memory.
+   *
+   * Spans cover pixels x1 through x2 - 1 on line y.  Rectangles cover width
+   * pixels right of x and height lines down from y.  Any portion outside the
+   * Bitmap's bounds is left undrawn.
+   */
+  void set_span(int x1, int x2, int y);
+  void clear_span(int x1, int x2, int y);
+  void invert_span(int x1, int x2, int y);
+
+  inline void draw_span(int x1, int x2, int y, bool set) {
+    if (set) {
+      set_span(x1, x2, y);
+    } else {
+      clear_span(x1, x2, y);
+    }
+  }
+
+  /*
+   * Filled rectangles.
+   */
+  void set_rect(int x, int y, int width, int height);
+  void clear_rect(int x, int y, int width, int height);
+  void invert_rect(int x, int y, int width, int height);
+
+  inline void draw_rect(int x, int y, int width, int height, bool set) {
+    if (set) {
+      set_rect(x, y, width, height);
+    } else {
+      clear_rect(x, y, width, height);
+    }
+  }
+
+  /*
+   * Rectangle outlines, one pixel wide, just inside the given area.
+   */
+  void set_rect_outline(int x, int y, int width, int height);
+  void clear_rect_outline(int x, int y, int width, int height);
+
+  inline void draw_rect_outline(int x, int y, int width, int height,
+                                bool set) {
+    if (set) {
+      set_rect_outline(x, y, width, height);
+    } else {
+      clear_rect_outline(x, y, width, height);
+    }
+  }
+
 private:
   Bitmap _b;
+  // Whether _b is in the SRAM bit-band region, so bit_addr can be used.
+  bool _bitband = false;
 
   unsigned *bit_addr(unsigned x, unsigned y);
   unsigned *word_addr(unsigned x, unsigned y);
@@ -104,10 +160,24 @@ private:
   template <bool S>
   inline void draw_line_unclipped(int x1, int y1, int x2, int y2);
 
+  template <bool S>
+  inline void draw_line_unclipped_words(int x1, int y1, int x2, int y2);
+
   enum class Direction : bool;
 
   template <bool, Direction, int>
   inline void draw_line_unclipped_spec(unsigned *, int, int);
+
+  enum class Op;
+
+  template <Op>
+  static inline void apply(unsigned &word, unsigned mask);
+
+  template <Op>
+  inline void rect_spec(int x1, int y1, int x2, int y2);
+
+  template <Op>
+  inline void rect_outline_spec(int x, int y, int width, int height);
 };
 
 }  // namespace vga
@@ -0,0 +1,490 @@
+#include "vga/graphics_8.h"
+
+#include <cstdint>
+
+#include "etl/algorithm.h"
+#include "etl/prediction.h"
+#include "etl/utility.h"
+
+#include "vga/blit_keyed.h"
+#include "vga/copy_words.h"
+#include "vga/shift_words.h"
+
+#define RAMCODE(sub) __attribute__((section(".ramcode." sub)))
+
+namespace vga {
+
+/*******************************************************************************
+ * Word-wide row primitives.  Each handles bytes up to the first word boundary
+ * in the destination, then whole words, then the bytes left over.
+ */
+
+// Below this many words, copy_words' setup and teardown costs more than it
+// saves over a simple loop.
+static constexpr unsigned copy_words_threshold = 16;
+
+static inline bool is_word_aligned(void const *p) {
+  return (reinterpret_cast<uintptr_t>(p) & 3) == 0;
+}
+
+/*
+ * Stores count bytes of color at out.
+ */
+RAMCODE("Graphics8.fill_row")
+static void fill_row(uint8_t *out, unsigned count, uint8_t color) {
+  while (count && !is_word_aligned(out)) {
+    *out++ = color;
+    --count;
+  }
+
+  uint32_t pattern = color * 0x01010101u;
+  auto words = reinterpret_cast<uint32_t *>(out);
+  while (count >= 16) {
+    words[0] = pattern;
+    words[1] = pattern;
+    words[2] = pattern;
+    words[3] = pattern;
+    words += 4;
+    count -= 16;
+  }
+  while (count >= 4) {
+    *words++ = pattern;
+    count -= 4;
+  }
+
+  out = reinterpret_cast<uint8_t *>(words);
+  while (count--) *out++ = color;
+}
+
+/*
+ * Copies count bytes from in to out.  Once out is aligned, words are moved
+ * with copy_words if in is aligned too, and funneled into alignment with
+ * shift_words if not.  Only words containing bytes of the row are read.
+ */
+RAMCODE("Graphics8.copy_row")
+static void copy_row(uint8_t const *in, uint8_t *out, unsigned count) {
+  while (count && !is_word_aligned(out)) {
+    *out++ = *in++;
+    --count;
+  }
+
+  unsigned words = count / 4;
+  if (words) {
+    auto dest = reinterpret_cast<uint32_t *>(out);
+    unsigned offset = reinterpret_cast<uintptr_t>(in) & 3;
+    auto source = reinterpret_cast<uint32_t const *>(in - offset);
+    if (offset) {
+      shift_words(source, dest, words, offset * 8);
+    } else if (words >= copy_words_threshold) {
+      copy_words(source, dest, words);
+    } else {
+      for (unsigned i = 0; i < words; ++i) dest[i] = source[i];
+    }
+    in += words * 4;
+    out += words * 4;
+    count %= 4;
+  }
+
+  while (count--) *out++ = *in++;
+}
+
+/*
+ * Copies count bytes from in to out, skipping bytes equal to key.
+ */
+RAMCODE("Graphics8.copy_row_keyed")
+static void copy_row_keyed(uint8_t const *in, uint8_t *out, unsigned count,
+                           uint8_t key) {
+  while (count && !is_word_aligned(out)) {
+    uint8_t c = *in++;
+    if (c != key) *out = c;
+    ++out;
+    --count;
+  }
+
+  unsigned words = count / 4;
+  if (words) {
+    blit_words_keyed(in, reinterpret_cast<uint32_t *>(out), words,
+                     key * 0x01010101u);
+    in += words * 4;
+    out += words * 4;
+    count %= 4;
+  }
+
+  while (count--) {
+    uint8_t c = *in++;
+    if (c != key) *out = c;
+    ++out;
+  }
+}
+
+/*
+ * Combines count bytes from in into out through a blend table, skipping bytes
+ * equal to the key.
+ */
+RAMCODE("Graphics8.copy_row_blended")
+static void copy_row_blended(uint8_t const *in, uint8_t *out, unsigned count,
+                             BlendParams const &params) {
+  uint8_t key = uint8_t(params.key);
+  unsigned mask = (1u << params.bits) - 1;
+  auto blend = [&](uint8_t c, uint8_t *o) {
+    if (c != key) {
+      *o = params.table[((c & mask) << params.bits) | (*o & mask)];
+    }
+  };
+
+  while (count && !is_word_aligned(out)) {
+    blend(*in++, out++);
+    --count;
+  }
+
+  unsigned words = count / 4;
+  if (words) {
+    blit_words_blended(in, reinterpret_cast<uint32_t *>(out), words, &params);
+    in += words * 4;
+    out += words * 4;
+    count %= 4;
+  }
+
+  while (count--) blend(*in++, out++);
+}
+
+
+/*******************************************************************************
+ * Basics: construction, pixel access, clearing.
+ */
+
+Graphics8::Graphics8(Color *base, unsigned width, unsigned height, int stride)
+  : _base(base),
+    _width(width),
+    _height(height),
+    _stride(stride ? stride : int(width)) {}
+
+void Graphics8::set_pixel(int x, int y, Color c) {
+  if (unsigned(x) >= _width || unsigned(y) >= _height) return;
+  *addr(x, y) = c;
+}
+
+auto Graphics8::get_pixel(int x, int y) const -> Color {
+  if (unsigned(x) >= _width || unsigned(y) >= _height) return 0;
+  return *addr(x, y);
+}
+
+RAMCODE("Graphics8.clear_all")
+void Graphics8::clear_all(Color c) {
+  if (_stride == int(_width)) {
+    fill_row(_base, _width * _height, c);
+  } else {
+    for (unsigned y = 0; y < _height; ++y) fill_row(addr(0, y), _width, c);
+  }
+}
+
+
+/*******************************************************************************
+ * Spans and rectangles.
+ */
+
+RAMCODE("Graphics8.draw_span")
+void Graphics8::draw_span(int x1, int x2, int y, Color c) {
+  if (unsigned(y) >= _height) return;
+  if (x1 < 0) x1 = 0;
+  if (x2 > int(_width)) x2 = _width;
+  if (x1 >= x2) return;
+
+  fill_row(addr(x1, y), x2 - x1, c);
+}
+
+RAMCODE("Graphics8.fill_rect")
+void Graphics8::fill_rect(int x, int y, int width, int height, Color c) {
+  int x2 = x + width, y2 = y + height;
+  if (x < 0) x = 0;
+  if (y < 0) y = 0;
+  if (x2 > int(_width)) x2 = _width;
+  if (y2 > int(_height)) y2 = _height;
+  if (x >= x2 || y >= y2) return;
+
+  for (int i = y; i < y2; ++i) fill_row(addr(x, i), x2 - x, c);
+}
+
+void Graphics8::draw_rect_outline(int x, int y, int width, int height,
+                                  Color c) {
+  if (width <= 0 || height <= 0) return;
+
+  int x2 = x + width, y2 = y + height;
+  fill_rect(x, y, width, 1, c);
+  if (height > 1) fill_rect(x, y2 - 1, width, 1, c);
+  if (height > 2) {
+    fill_rect(x, y + 1, 1, height - 2, c);
+    if (width > 1) fill_rect(x2 - 1, y + 1, 1, height - 2, c);
+  }
+}
+
+
+/*******************************************************************************
+ * Bresenham line drawing with Cohen-Sutherland clipping.
+ */
+
+enum {
+  out_left = 1,
+  out_right = 2,
+  out_bottom = 4,
+  out_top = 8,
+};
+
+unsigned Graphics8::compute_out_code(int x, int y) {
+  unsigned code = 0;
+
+  if (x < 0) code |= out_left;
+  else if (x >= int(_width)) code |= out_right;
+
+  if (y < 0) code |= out_top;
+  else if (y >= int(_height)) code |= out_bottom;
+
+  return code;
+}
+
+RAMCODE("Graphics8.draw_line_unclipped")
+void Graphics8::draw_line_unclipped(int x1, int y1, int x2, int y2, Color c) {
+  if (ETL_UNLIKELY(y1 == y2)) {
+    if (x1 > x2) etl::swap(x1, x2);
+    fill_row(addr(x1, y1), x2 - x1 + 1, c);
+    return;
+  }
+
+  int dx = x2 > x1 ? x2 - x1 : x1 - x2;
+  int dy = y2 > y1 ? y1 - y2 : y2 - y1;  // Nonpositive.
+  int x_step = x2 > x1 ? 1 : -1;
+  int y_step = y2 > y1 ? _stride : -_stride;
+
+  Color *out = addr(x1, y1);
+  int error = dx + dy;
+  int remaining = dx > -dy ? dx : -dy;
+
+  *out = c;
+  while (remaining--) {
+    int e2 = error * 2;
+    if (e2 >= dy) {
+      error += dy;
+      out += x_step;
+    }
+    if (e2 <= dx) {
+      error += dx;
+      out += y_step;
+    }
+    *out = c;
+  }
+}
+
+/*
+ * Divides, rounding to nearest.
+ */
+static int divide_rounded(int n, int d) {
+  if (d < 0) {
+    n = -n;
+    d = -d;
+  }
+  return n >= 0 ? (n + d / 2) / d : -((d / 2 - n) / d);
+}
+
+RAMCODE("Graphics8.draw_line")
+void Graphics8::draw_line(int x1, int y1, int x2, int y2, Color c) {
+  unsigned code0 = compute_out_code(x1, y1);
+  unsigned code1 = compute_out_code(x2, y2);
+
+  // Intersections are taken with the original line, and rounded, so each
+  // clipped endpoint is the pixel nearest the true one.  Working from an
+  // endpoint that's already been clipped would compound the errors.
+  int const ox = x1, oy = y1, dx = x2 - x1, dy = y2 - y1;
+
+  while (code0 || code1) {
+    if (code0 & code1) return;  // Reject line; outside framebuffer.
+
+    unsigned code = code0 ? code0 : code1;
+    int x, y;
+
+    if (code & out_bottom) {
+      y = _height - 1;
+      x = ox + divide_rounded(dx * (y - oy), dy);
+    } else if (code & out_top) {
+      y = 0;
+      x = ox + divide_rounded(dx * -oy, dy);
+    } else if (code & out_right) {
+      x = _width - 1;
+      y = oy + divide_rounded(dy * (x - ox), dx);
+    } else /*if (code & out_left)*/ {
+      x = 0;
+      y = oy + divide_rounded(dy * -ox, dx);
+    }
+
+    if (code == code0) {
+      x1 = x;
+      y1 = y;
+      code0 = compute_out_code(x1, y1);
+    } else {
+      x2 = x;
+      y2 = y;
+      code1 = compute_out_code(x2, y2);
+    }
+  }
+
+  draw_line_unclipped(x1, y1, x2, y2, c);
+}
+
+
+/*******************************************************************************
+ * Polygons and circles.
+ */
+
+RAMCODE("Graphics8.fill_polygon")
+void Graphics8::fill_polygon(Point const *points, unsigned count, Color c) {
+  if (count < 3) return;
+
+  int top = points[0].y, bottom = points[0].y;
+  for (unsigned i = 1; i < count; ++i) {
+    top = etl::min(top, points[i].y);
+    bottom = etl::max(bottom, points[i].y);
+  }
+  if (top < 0) top = 0;
+  if (bottom > int(_height)) bottom = _height;
+
+  // Line y is sampled at its center, y + 0.5, so it's crossed by edges with
+  // top <= y < bottom.  Crossings are in 16.16 fixed point.
+  for (int y = top; y < bottom; ++y) {
+    int32_t crossings[max_polygon_crossings];
+    unsigned n = 0;
+
+    for (unsigned i = 0; i < count && n < max_polygon_crossings; ++i) {
+      Point a = points[i];
+      Point b = points[i + 1 == count ? 0 : i + 1];
+      if (a.y > b.y) etl::swap(a, b);
+      if (y < a.y || y >= b.y) continue;
+
+      int32_t slope = (b.x - a.x) * 65536 / (b.y - a.y);
+      int32_t x = a.x * 65536 + slope * (y - a.y) + slope / 2;
+
+      // Insertion sort; there are seldom more than a handful.
+      unsigned j = n++;
+      while (j && crossings[j - 1] > x) {
+        crossings[j] = crossings[j - 1];
+        --j;
+      }
+      crossings[j] = x;
+    }
+
+    // Pixel x is inside a span if its center, x + 0.5, is.
+    for (unsigned i = 0; i + 1 < n; i += 2) {
+      draw_span((crossings[i] + 0x7FFF) >> 16,
+                (crossings[i + 1] + 0x7FFF) >> 16,
+                y, c);
+    }
+  }
+}
+
+void Graphics8::draw_circle(int cx, int cy, int radius, Color c) {
+  if (radius < 0) return;
+
+  // Walk the octant from (radius, 0) to the diagonal, tracking the midpoint
+  // decision variable, and reflect each pixel into the other seven.
+  int x = radius, y = 0;
+  int error = 1 - radius;
+  while (x >= y) {
+    set_pixel(cx + x, cy + y, c);
+    set_pixel(cx - x, cy + y, c);
+    set_pixel(cx + x, cy - y, c);
+    set_pixel(cx - x, cy - y, c);
+    set_pixel(cx + y, cy + x, c);
+    set_pixel(cx - y, cy + x, c);
+    set_pixel(cx + y, cy - x, c);
+    set_pixel(cx - y, cy - x, c);
+
+    ++y;
+    if (error < 0) {
+      error += 2 * y + 1;
+    } else {
+      --x;
+      error += 2 * (y - x) + 1;
+    }
+  }
+}
+
+RAMCODE("Graphics8.fill_circle")
+void Graphics8::fill_circle(int cx, int cy, int radius, Color c) {
+  if (radius < 0) return;
+
+  // As draw_circle, but joining the reflected pixels with spans.  Lines near
+  // the diagonal get filled twice; that's cheaper than avoiding it.
+  int x = radius, y = 0;
+  int error = 1 - radius;
+  while (x >= y) {
+    draw_span(cx - x, cx + x + 1, cy + y, c);
+    if (y) draw_span(cx - x, cx + x + 1, cy - y, c);
+    draw_span(cx - y, cx + y + 1, cy + x, c);
+    draw_span(cx - y, cx + y + 1, cy - x, c);
+
+    ++y;
+    if (error < 0) {
+      error += 2 * y + 1;
+    } else {
+      --x;
+      error += 2 * (y - x) + 1;
+    }
+  }
+}
+
+
+/*******************************************************************************
+ * Blits.
+ */
+
+enum class Graphics8::BlitOp {
+  copy,
+  keyed,
+  blended,
+};
+
+template <Graphics8::BlitOp O>
+inline void Graphics8::blit_spec(Image const &image, int x, int y, Color key,
+                                 BlendTable const *table) {
+  int sx = 0, sy = 0;
+  int width = image.width, height = image.height;
+
+  if (x < 0) { sx = -x; width += x; x = 0; }
+  if (y < 0) { sy = -y; height += y; y = 0; }
+  if (x + width > int(_width)) width = int(_width) - x;
+  if (y + height > int(_height)) height = int(_height) - y;
+  if (width <= 0 || height <= 0) return;
+
+  BlendParams params = {};
+  if (O == BlitOp::blended) {
+    params = { table->entries, key * 0x01010101u, table->bits };
+  }
+
+  Color const *in = image.pixels + sy * image.stride + sx;
+  Color *out = addr(x, y);
+  for (int i = 0; i < height; ++i) {
+    switch (O) {
+      case BlitOp::copy:    copy_row(in, out, width); break;
+      case BlitOp::keyed:   copy_row_keyed(in, out, width, key); break;
+      case BlitOp::blended: copy_row_blended(in, out, width, params); break;
+    }
+    in += image.stride;
+    out += _stride;
+  }
+}
+
+RAMCODE("Graphics8.blit")
+void Graphics8::blit(Image const &image, int x, int y) {
+  blit_spec<BlitOp::copy>(image, x, y, 0, nullptr);
+}
+
+RAMCODE("Graphics8.blit_keyed")
+void Graphics8::blit_keyed(Image const &image, int x, int y, Color key) {
+  blit_spec<BlitOp::keyed>(image, x, y, key, nullptr);
+}
+
+RAMCODE("Graphics8.blit_blended")
+void Graphics8::blit_blended(Image const &image, int x, int y,
+                             BlendTable const &table, Color key) {
+  blit_spec<BlitOp::blended>(image, x, y, key, &table);
+}
+
+}  // namespace vga
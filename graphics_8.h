@@ -0,0 +1,162 @@
+#ifndef VGA_GRAPHICS_8_H
+#define VGA_GRAPHICS_8_H
+
+#include <cstdint>
+
+namespace vga {
+
+/*
+ * Provides primitive graphics operations on an 8bpp framebuffer, such as the
+ * pages handed out by Direct and Palette8 (see their make_bg_graphics).  What
+ * the bytes mean -- colors or palette indices -- is up to the caller.
+ *
+ * Everything is clipped to the framebuffer.  Spans, rectangles, and blits
+ * write whole words wherever they can; keyed and blended blits use the M4's
+ * SIMD byte instructions to merge four pixels at a time (see blit_keyed.S).
+ */
+class Graphics8 {
+public:
+  using Color = std::uint8_t;
+
+  struct Point {
+    int x;
+    int y;
+  };
+
+  /*
+   * A read-only 8bpp image, for use as a blit source.  stride is the distance
+   * between lines in bytes, and may be negative for bottom-up images.
+   */
+  struct Image {
+    Color const *pixels;
+    unsigned width;
+    unsigned height;
+    int stride;
+  };
+
+  /*
+   * A blend lookup table, giving the result of drawing each source color over
+   * each destination color, in the framebuffer's own pixel format -- e.g. to
+   * make sprites translucent.  Entries are indexed by (source << bits) | dest.
+   *
+   * bits may be 8, for a full table of 256x256 entries (64 KiB, so usually in
+   * Flash), or 6, for a table of 64x64 entries (4 KiB) that fits comfortably
+   * in RAM.  Only the low bits of each color index the table, so with 6, the
+   * top two bits of both colors are ignored -- which suits the 6-bit DAC.
+   */
+  struct BlendTable {
+    Color const *entries;
+    unsigned bits;
+  };
+
+  // Most edges a single line of a polygon may cross.  See fill_polygon.
+  static constexpr unsigned max_polygon_crossings = 32;
+
+  Graphics8() = default;
+
+  /*
+   * Wraps a framebuffer of width x height pixels.  stride is the distance
+   * between lines in bytes, and defaults to width.
+   */
+  Graphics8(Color *base, unsigned width, unsigned height, int stride = 0);
+
+  unsigned get_width() const { return _width; }
+  unsigned get_height() const { return _height; }
+
+  /*
+   * Sets every pixel to the given color.
+   */
+  void clear_all(Color);
+
+  /*
+   * Sets a pixel, if it is within the framebuffer's bounds.
+   */
+  void set_pixel(int x, int y, Color);
+
+  /*
+   * Reads a pixel.  Pixels outside the framebuffer read as zero.
+   */
+  Color get_pixel(int x, int y) const;
+
+  /*
+   * Draws a line from (x1, y1) to (x2, y2), inclusive.  Any portion of the
+   * line outside the framebuffer is left undrawn.
+   */
+  void draw_line(int x1, int y1, int x2, int y2, Color);
+
+  /*
+   * Fills pixels x1 through x2 - 1 on line y.
+   */
+  void draw_span(int x1, int x2, int y, Color);
+
+  /*
+   * Fills width pixels right of x and height lines down from y.
+   */
+  void fill_rect(int x, int y, int width, int height, Color);
+
+  /*
+   * Draws a rectangle outline, one pixel wide, just inside the given area.
+   */
+  void draw_rect_outline(int x, int y, int width, int height, Color);
+
+  /*
+   * Fills a polygon with the even-odd rule, sampling at pixel centers, so
+   * that polygons sharing an edge don't overlap.  Vertices are given in
+   * order, and the last is implicitly joined to the first.  Coordinates must
+   * be less than 16384 in magnitude (they're handled as 16.16 fixed point).
+   *
+   * On lines crossing more than max_polygon_crossings edges, the excess edges
+   * are ignored.
+   */
+  void fill_polygon(Point const *, unsigned count, Color);
+
+  /*
+   * Draws a circle outline, or fills a circle, centered on (x, y), using the
+   * integer midpoint algorithm.  Radius zero draws a single pixel.
+   */
+  void draw_circle(int x, int y, int radius, Color);
+  void fill_circle(int x, int y, int radius, Color);
+
+  /*
+   * Copies an image into the framebuffer with its top left corner at (x, y).
+   * The image must not overlap the framebuffer in memory.
+   */
+  void blit(Image const &, int x, int y);
+
+  /*
+   * Like blit, but pixels of the image equal to key are skipped, leaving the
+   * framebuffer's pixels showing through.
+   */
+  void blit_keyed(Image const &, int x, int y, Color key);
+
+  /*
+   * Like blit_keyed, but pixels of the image are combined with the
+   * framebuffer's through the blend table, rather than replacing them.
+   */
+  void blit_blended(Image const &, int x, int y, BlendTable const &,
+                    Color key);
+
+private:
+  Color *_base = nullptr;
+  unsigned _width = 0;
+  unsigned _height = 0;
+  int _stride = 0;
+
+  Color *addr(unsigned x, unsigned y) const {
+    return _base + int(y) * _stride + int(x);
+  }
+
+  unsigned compute_out_code(int x, int y);
+
+  void draw_line_unclipped(int x1, int y1, int x2, int y2, Color);
+
+  enum class BlitOp;
+
+  template <BlitOp>
+  inline void blit_spec(Image const &, int x, int y, Color key,
+                        BlendTable const *);
+};
+
+}  // namespace vga
+
+#endif  // VGA_GRAPHICS_8_H
@@ -0,0 +1,130 @@
+#include "vga/profile.h"
+
+#include "etl/attribute_macros.h"
+
+#include "vga/scan.h"
+
+#define RAM_CODE ETL_SECTION(".ramcode")
+
+namespace vga {
+
+static BandProfile bands[profile_max_bands];
+static RasterizerProfile rasterizers[profile_max_rasterizers];
+
+static unsigned deadline_misses;
+
+static void reset_stats(ProfileStats &s) {
+  s.count = 0;
+  s.min_cycles = 0;
+  s.max_cycles = 0;
+  s.total_cycles = 0;
+  for (auto &bin : s.histogram) bin = 0;
+}
+
+void profile_reset() {
+  for (auto &b : bands) {
+    b.rasterizer = nullptr;
+    reset_stats(b.rasterize);
+    reset_stats(b.update_scan_buffer);
+    reset_stats(b.prepare_for_scanout);
+    b.deadline_misses = 0;
+  }
+  for (auto &r : rasterizers) {
+    r.rasterizer = nullptr;
+    reset_stats(r.rasterize);
+  }
+  deadline_misses = 0;
+}
+
+BandProfile const *profile_get_band(unsigned index) {
+  if (index >= profile_max_bands) return nullptr;
+  return &bands[index];
+}
+
+RasterizerProfile const *profile_get_rasterizer(unsigned index) {
+  if (index >= profile_max_rasterizers) return nullptr;
+  if (!rasterizers[index].rasterizer) return nullptr;
+  return &rasterizers[index];
+}
+
+unsigned profile_deadline_misses() {
+  return deadline_misses;
+}
+
+#ifdef VGA_PROFILE
+
+static BandProfile &band_at(unsigned index) {
+  return bands[index < profile_max_bands ? index : profile_max_bands - 1];
+}
+
+/*
+ * Finds the entry for a rasterizer, claiming a free one if it's new.  Returns
+ * nullptr if the table is full.
+ */
+RAM_CODE
+static RasterizerProfile *rasterizer_entry(Rasterizer const *r) {
+  for (auto &e : rasterizers) {
+    if (e.rasterizer == r) return &e;
+    if (!e.rasterizer) {
+      e.rasterizer = r;
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+RAM_CODE
+static unsigned cycles_since(unsigned start) {
+  // SysTick counts down, and is only 24 bits wide.
+  return (start - profile_clock()) & 0xFFFFFF;
+}
+
+RAM_CODE
+static void accumulate(ProfileStats *s, unsigned cycles) {
+  if (s->count == 0 || cycles < s->min_cycles) s->min_cycles = cycles;
+  ++s->count;
+  if (cycles > s->max_cycles) s->max_cycles = cycles;
+  s->total_cycles += cycles;
+
+  auto const &t = scan::current_timing;
+  unsigned line_cycles = t.line_pixels * t.cycles_per_pixel;
+  unsigned bin = cycles * 8 / line_cycles;
+  if (bin >= profile_histogram_bins) bin = profile_histogram_bins - 1;
+  ++s->histogram[bin];
+}
+
+RAM_CODE
+void profile_record(ProfilePhase phase, unsigned band, unsigned start) {
+  unsigned cycles = cycles_since(start);
+
+  auto &b = band_at(band);
+  ProfileStats *s;
+  switch (phase) {
+    case ProfilePhase::rasterize:           s = &b.rasterize; break;
+    case ProfilePhase::update_scan_buffer:  s = &b.update_scan_buffer; break;
+    default:                                s = &b.prepare_for_scanout; break;
+  }
+  accumulate(s, cycles);
+}
+
+RAM_CODE
+void profile_record_rasterize(unsigned band, Rasterizer const *r,
+                              unsigned start) {
+  unsigned cycles = cycles_since(start);
+
+  auto &b = band_at(band);
+  b.rasterizer = r;
+  accumulate(&b.rasterize, cycles);
+
+  if (auto e = rasterizer_entry(r)) accumulate(&e->rasterize, cycles);
+}
+
+RAM_CODE
+void profile_record_deadline_miss(unsigned band) {
+  ++band_at(band).deadline_misses;
+  ++deadline_misses;
+}
+
+#endif  // VGA_PROFILE
+
+}  // namespace vga
@@ -0,0 +1,155 @@
+#ifndef VGA_PROFILE_H
+#define VGA_PROFILE_H
+
+#include <cstdint>
+
+#include "etl/attribute_macros.h"
+
+#include "vga/rasterizer.h"
+
+#ifdef VGA_PROFILE
+#include "vga/measurement.h"
+#endif
+
+namespace vga {
+
+/*******************************************************************************
+ * Rasterization budget profiling.
+ *
+ * When the build environment defines VGA_PROFILE, the driver measures the
+ * work it does for each line -- rasterization, scan buffer update, and DMA
+ * preparation -- and accumulates statistics per Band.  Rasterization time is
+ * also kept per Rasterizer, for rasterizers shared between bands or swapped
+ * in and out by editing the band list.  It also counts deadline misses: lines
+ * that hadn't been rasterized by the time the driver needed to hand them to
+ * scanout, even with the lookahead queue.
+ *
+ * Measurements use the SysTick timer, so the application must call mtim_init
+ * before starting video.  Reading SysTick doesn't touch AHB1, so unlike the
+ * GPIO signals in measurement.h this is safe to leave on while displaying.
+ *
+ * Without VGA_PROFILE the hooks compile to nothing and the statistics below
+ * simply stay at zero.
+ */
+
+static constexpr unsigned
+  // Bands beyond this index are lumped into the last entry.
+  profile_max_bands = 8,
+  // Rasterizers seen after this many distinct ones aren't tracked
+  // individually, though their time still counts toward their bands.
+  profile_max_rasterizers = 8,
+  // Histogram bins are each 1/8 of a line period; the last bin also collects
+  // everything longer.
+  profile_histogram_bins = 16;
+
+/*
+ * Statistics for one phase of line processing.  Times are in CPU cycles.
+ */
+struct ProfileStats {
+  unsigned count;
+  unsigned min_cycles;
+  unsigned max_cycles;
+  std::uint64_t total_cycles;
+  unsigned histogram[profile_histogram_bins];
+};
+
+/*
+ * Statistics for one Band, indexed by its position in the band list.
+ */
+struct BandProfile {
+  // The rasterizer most recently seen in this band.  The stats below cover
+  // every rasterizer the band has used since the last reset; for a breakdown
+  // by rasterizer, see RasterizerProfile.
+  Rasterizer const *rasterizer;
+
+  ProfileStats rasterize;
+  ProfileStats update_scan_buffer;
+  ProfileStats prepare_for_scanout;
+
+  // Lines in this band that were not rasterized in time.
+  unsigned deadline_misses;
+};
+
+/*
+ * Rasterization statistics for one Rasterizer, across all bands using it.
+ */
+struct RasterizerProfile {
+  Rasterizer const *rasterizer;
+  ProfileStats rasterize;
+};
+
+/*
+ * Clears all accumulated statistics.  Best done during vertical blank.
+ */
+void profile_reset();
+
+/*
+ * Returns the statistics for the band at the given index, or nullptr if the
+ * index is out of range.  The driver updates these from interrupts, so values
+ * are only mutually consistent if read during vertical blank.
+ */
+BandProfile const *profile_get_band(unsigned index);
+
+/*
+ * Returns the statistics for the index'th distinct rasterizer seen since the
+ * last reset, or nullptr if fewer have been seen.  The same consistency
+ * caveat applies as for profile_get_band.
+ */
+RasterizerProfile const *profile_get_rasterizer(unsigned index);
+
+/*
+ * Total deadline misses across all bands since the last reset.
+ */
+unsigned profile_deadline_misses();
+
+
+/*******************************************************************************
+ * Driver hooks.
+ */
+
+enum class ProfilePhase {
+  rasterize,
+  update_scan_buffer,
+  prepare_for_scanout,
+};
+
+#ifdef VGA_PROFILE
+
+ETL_INLINE unsigned profile_clock() {
+  return mtim_get();
+}
+
+/*
+ * Records a phase that began at the given profile_clock reading and ended
+ * just now.
+ */
+void profile_record(ProfilePhase, unsigned band, unsigned start);
+
+/*
+ * Like profile_record for ProfilePhase::rasterize, but also charges the time
+ * to the given rasterizer.
+ */
+void profile_record_rasterize(unsigned band, Rasterizer const *,
+                              unsigned start);
+
+/*
+ * Records that a line in a band wasn't ready for scanout.
+ */
+void profile_record_deadline_miss(unsigned band);
+
+#else
+
+ETL_INLINE unsigned profile_clock() { return 0; }
+
+ETL_INLINE void profile_record(ProfilePhase, unsigned, unsigned) {}
+
+ETL_INLINE void profile_record_rasterize(unsigned, Rasterizer const *,
+                                         unsigned) {}
+
+ETL_INLINE void profile_record_deadline_miss(unsigned) {}
+
+#endif
+
+}  // namespace vga
+
+#endif  // VGA_PROFILE_H
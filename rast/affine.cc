@@ -0,0 +1,104 @@
+#include "vga/rast/affine.h"
+
+#include "etl/assert.h"
+#include "etl/prediction.h"
+
+#include "vga/arena.h"
+#include "vga/rast/unpack_affine.h"
+
+namespace vga {
+namespace rast {
+
+Affine::Affine(unsigned disp_width, unsigned disp_height,
+               unsigned scale_x, unsigned scale_y,
+               unsigned width_log2, unsigned height_log2,
+               unsigned top_line)
+  : _width(disp_width / scale_x),
+    _height(disp_height / scale_y),
+    _scale_x(scale_x),
+    _scale_y(scale_y),
+    _top_line(top_line),
+    _width_log2(width_log2),
+    _height_log2(height_log2),
+    _texture(arena_new_array<Pixel>(1u << (width_log2 + height_log2))),
+    _transform{0, 0, 0x10000, 0, 0, 0x10000},
+    _pending_transform(_transform),
+    _transform_pended(false),
+    _line_table(nullptr) {
+  // The sampler keeps the integer part of each coordinate in the top bits of
+  // a 32-bit register, leaving at least 16 bits of fraction.
+  ETL_ASSERT(width_log2 <= 16 && height_log2 <= 16);
+
+  for (unsigned i = 0; i < (1u << (width_log2 + height_log2)); ++i) {
+    _texture[i] = 0;
+  }
+}
+
+Affine::~Affine() {
+  _texture = nullptr;
+}
+
+void Affine::set_transform(Transform const &t) {
+  // Like Sprites::commit: clearing the flag keeps rasterize away from the
+  // pending copy while we write it.
+  _transform_pended = false;
+  _pending_transform = t;
+  _transform_pended = true;
+}
+
+__attribute__((section(".ramcode")))
+auto Affine::rasterize(unsigned cycles_per_pixel,
+                       unsigned line_number,
+                       Pixel *target) -> RasterInfo {
+  line_number -= _top_line;
+  auto repeat = (_scale_y - 1) - (line_number % _scale_y);
+  line_number /= _scale_y;
+
+  if (ETL_UNLIKELY(line_number == 0)) {
+    if (_transform_pended.exchange(false)) _transform = _pending_transform;
+  }
+
+  if (ETL_UNLIKELY(line_number >= _height)) {
+    return { 0, 0, cycles_per_pixel, 0 };
+  }
+
+  std::uint32_t u, v, du, dv;
+  if (_line_table) {
+    auto const &lt = _line_table[line_number];
+    u = lt.u;
+    v = lt.v;
+    du = lt.du;
+    dv = lt.dv;
+  } else {
+    auto const &t = _transform;
+    u = std::uint32_t(t.u) + line_number * std::uint32_t(t.du_dy);
+    v = std::uint32_t(t.v) + line_number * std::uint32_t(t.dv_dy);
+    du = t.du_dx;
+    dv = t.dv_dx;
+  }
+
+  // Move from 16.16 into the sampler's representation, with the integer part
+  // of each coordinate in the top bits.  See unpack_affine.h.
+  unsigned const us = 16 - _width_log2, vs = 16 - _height_log2;
+  AffineSpan span = {
+    .u = u << us,
+    .v = v << vs,
+    .du = du << us,
+    .dv = dv << vs,
+    .u_shift = 32 - _width_log2,
+    .v_shift = 32 - _width_log2 - _height_log2,
+    .v_mask = ((1u << _height_log2) - 1) << _width_log2,
+  };
+
+  unpack_affine_impl(_texture, target, (_width + 3) / 4, &span);
+
+  return {
+    .offset = 0,
+    .length = _width,
+    .cycles_per_pixel = cycles_per_pixel * _scale_x,
+    .repeat_lines = repeat,
+  };
+}
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,110 @@
+#ifndef VGA_RAST_AFFINE_H
+#define VGA_RAST_AFFINE_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "vga/rasterizer.h"
+
+namespace vga {
+namespace rast {
+
+/*
+ * Draws a texture through an affine transform -- rotated, scaled, sheared --
+ * without a framebuffer.  Each line is a straight walk through the texture,
+ * so memory use is just the texture, however large the apparent plane.  The
+ * texture repeats endlessly in all directions.
+ *
+ * The transform can be given for the whole screen, or line by line from a
+ * table, which allows perspective ("mode 7") floors and wavy distortions.
+ *
+ * The texture's sides must be powers of two.  At about 10 cycles per pixel,
+ * this wants pixels multiplied: at 800x600, tool/check_budget allows about
+ * 3150 cycles per line, and a line of 400 pixels (scale_x of 2) costs about
+ * 4060.  Use scale_x of 3 or more, or scale_y of 2 or more so that each line
+ * is rasterized once and repeated.
+ *
+ * Coordinates are 16.16 fixed point, in texels.
+ */
+class Affine : public Rasterizer {
+public:
+  /*
+   * Maps screen position (x, y), in unmultiplied pixels, to texture position
+   * (u + x * du_dx + y * du_dy, v + x * dv_dx + y * dv_dy).
+   */
+  struct Transform {
+    std::int32_t u, v;
+    std::int32_t du_dx, dv_dx;
+    std::int32_t du_dy, dv_dy;
+  };
+
+  /*
+   * Texture position at the start of one line, and the step per pixel.
+   */
+  struct LineTransform {
+    std::int32_t u, v;
+    std::int32_t du, dv;
+  };
+
+  /*
+   * Creates an Affine with the given configuration:
+   * - disp_width and disp_height give the native size of the display, e.g.
+   *   800x600.
+   * - scale_x and scale_y give the subdivision factors, as for Direct.
+   * - width_log2 and height_log2 give the size of the texture: 2^width_log2
+   *   by 2^height_log2 pixels.  Each must be at most 16.
+   * - top_line applies an offset to the start of rasterization, for use when
+   *   this rasterizer starts somewhere other than the top of the display.
+   *
+   * The texture is allocated from the arena and starts out zeroed.  The
+   * transform starts out as the identity.
+   */
+  Affine(unsigned disp_width, unsigned disp_height,
+         unsigned scale_x, unsigned scale_y,
+         unsigned width_log2, unsigned height_log2,
+         unsigned top_line = 0);
+  ~Affine();
+
+  RasterInfo rasterize(unsigned, unsigned, Pixel *) override;
+
+  unsigned get_width() const { return _width; }
+  unsigned get_height() const { return _height; }
+
+  /*
+   * Returns the texture: rows of 2^width_log2 Pixels.
+   */
+  Pixel *get_texture() const { return _texture; }
+
+  /*
+   * Sets the transform for the whole screen, to take effect at the top of the
+   * next frame.  Only the most recent transform set before then is used.
+   */
+  void set_transform(Transform const &);
+
+  /*
+   * Sets a table of per-line transforms, one entry for each (unmultiplied)
+   * line, which takes precedence over set_transform.  The table is used in
+   * place, so it may be changed to animate the effect, and must outlive its
+   * use.  nullptr returns to set_transform.
+   */
+  void set_line_table(LineTransform const *table) { _line_table = table; }
+
+private:
+  unsigned _width;
+  unsigned _height;
+  unsigned _scale_x;
+  unsigned _scale_y;
+  unsigned _top_line;
+  unsigned _width_log2;
+  unsigned _height_log2;
+  Pixel *_texture;
+  Transform _transform;
+  Transform _pending_transform;
+  std::atomic<bool> _transform_pended;
+  LineTransform const *_line_table;
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_AFFINE_H
@@ -2,7 +2,6 @@
 
 #include <cstdint>
 
-#include "etl/assert.h"
 #include "etl/prediction.h"
 
 #include "vga/arena.h"
@@ -15,21 +14,23 @@ using std::uint32_t;
 namespace vga {
 namespace rast {
 
-Bitmap_1::Bitmap_1(unsigned width, unsigned height, unsigned top_line)
-  : Bitmap_1(width, height, nullptr, top_line) {}
+Bitmap_1::Bitmap_1(unsigned width, unsigned height, unsigned top_line,
+                   ArenaPlacement placement)
+  : Bitmap_1(width, height, nullptr, top_line, placement) {}
 
 Bitmap_1::Bitmap_1(unsigned width,
                    unsigned height,
                    Pixel const * background,
-                   unsigned top_line)
+                   unsigned top_line,
+                   ArenaPlacement placement)
   : _lines(height),
     _words_per_line(width / 32),
     _top_line(top_line),
     _page1(false),
     _flip_pended(false),
     _clut{ 0, 0xFF },
-    _fb{ arena_new_array<uint32_t>(_words_per_line * _lines),
-         arena_new_array<uint32_t>(_words_per_line * _lines) },
+    _fb{ arena_new_array<uint32_t>(_words_per_line * _lines, placement),
+         arena_new_array<uint32_t>(_words_per_line * _lines, placement) },
     _background{background}
 {}
 
@@ -74,8 +75,6 @@ Bitmap Bitmap_1::get_bg_bitmap() const {
 }
 
 Graphics1 Bitmap_1::make_bg_graphics() const {
-  ETL_ASSERT(can_bg_use_bitband());
-
   return Graphics1(get_bg_bitmap());
 }
 
@@ -88,13 +87,13 @@ void Bitmap_1::flip_now() {
 }
 
 bool Bitmap_1::can_fg_use_bitband() const {
-  unsigned addr = reinterpret_cast<unsigned>(_fb[_page1]);
+  auto addr = reinterpret_cast<std::uintptr_t>(_fb[_page1]);
   return (addr >= 0x20000000 && addr < 0x20100000)
       || (addr < 0x100000);
 }
 
 bool Bitmap_1::can_bg_use_bitband() const {
-  unsigned addr = reinterpret_cast<unsigned>(_fb[!_page1]);
+  auto addr = reinterpret_cast<std::uintptr_t>(_fb[!_page1]);
   return (addr >= 0x20000000 && addr < 0x20100000)
       || (addr < 0x100000);
 }
@@ -105,6 +104,10 @@ void Bitmap_1::copy_bg_to_fg() const {
              _words_per_line * _lines);
 }
 
+void Bitmap_1::copy_dirty_fg_to_bg() {
+  _dirty.copy_rows(_fb[_page1], _fb[!_page1], _words_per_line, _lines);
+}
+
 void Bitmap_1::set_fg_color(Pixel c) {
   _clut[1] = c;
 }
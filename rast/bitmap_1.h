@@ -4,8 +4,10 @@
 #include <atomic>
 #include <cstdint>
 
+#include "vga/arena.h"
 #include "vga/bitmap.h"
 #include "vga/rasterizer.h"
+#include "vga/rast/dirty_lines.h"
 #include "vga/graphics_1.h"
 
 namespace vga {
@@ -16,15 +18,21 @@ public:
   /*
    * Creates a 1bpp bitmap rasterizer with the given width, height, and
    * optional offset.
+   *
+   * Graphics1 (make_bg_graphics) draws pixels and lines fastest in bit-band
+   * RAM; pass ArenaPlacement::bitband as the placement to ensure both
+   * framebuffers land there.
    */
-  Bitmap_1(unsigned width, unsigned height, unsigned top_line = 0);
+  Bitmap_1(unsigned width, unsigned height, unsigned top_line = 0,
+           ArenaPlacement placement = ArenaPlacement::any);
 
   /*
    * Creates a 1bpp bitmap rasterizer with the given width, height, background
-   * image, and optional offset.
+   * image, and optional offset and framebuffer placement.
    */
   Bitmap_1(unsigned width, unsigned height, Pixel const * background,
-           unsigned top_line = 0);
+           unsigned top_line = 0,
+           ArenaPlacement placement = ArenaPlacement::any);
 
   ~Bitmap_1();
 
@@ -53,6 +61,13 @@ public:
   bool can_bg_use_bitband() const;
   void copy_bg_to_fg() const;
 
+  // Dirty-line tracking for the background buffer; see DirtyLines.
+  void enable_dirty_tracking() { _dirty.enable(_lines); }
+  void mark_dirty(unsigned first, unsigned count = 1) {
+    _dirty.mark(first, count);
+  }
+  void copy_dirty_fg_to_bg();
+
 private:
   unsigned _lines;
   unsigned _words_per_line;
@@ -62,6 +77,7 @@ private:
   Pixel _clut[2];
   std::uint32_t *_fb[2];
   Pixel const * _background;
+  DirtyLines _dirty;
 };
 
 }  // namespace rast
@@ -66,5 +66,12 @@ void Direct::pend_flip() {
   _flip_pended = true;
 }
 
+void Direct::copy_dirty_fg_to_bg() {
+  _dirty.copy_rows((uint32_t const *) (void const *) get_fg_buffer(),
+                   (uint32_t *) (void *) get_bg_buffer(),
+                   _width / sizeof(uint32_t),
+                   _height);
+}
+
 }  // namespace rast
 }  // namespace vga
@@ -3,7 +3,9 @@
 
 #include <atomic>
 
+#include "vga/graphics_8.h"
 #include "vga/rasterizer.h"
+#include "vga/rast/dirty_lines.h"
 
 namespace vga {
 namespace rast {
@@ -58,6 +60,20 @@ public:
   Pixel *get_fg_buffer() const { return _fb[_page1]; }
   Pixel *get_bg_buffer() const { return _fb[!_page1]; }
 
+  /*
+   * Returns a Graphics8 for drawing on the background buffer.
+   */
+  Graphics8 make_bg_graphics() const {
+    return Graphics8(get_bg_buffer(), _width, _height);
+  }
+
+  // Dirty-line tracking for the background buffer; see DirtyLines.
+  void enable_dirty_tracking() { _dirty.enable(_height); }
+  void mark_dirty(unsigned first, unsigned count = 1) {
+    _dirty.mark(first, count);
+  }
+  void copy_dirty_fg_to_bg();
+
 private:
   unsigned _width;
   unsigned _height;
@@ -67,6 +83,7 @@ private:
   Pixel *_fb[2];
   bool _page1;
   std::atomic<bool> _flip_pended;
+  DirtyLines _dirty;
 };
 
 }  // namespace rast
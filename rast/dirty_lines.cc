@@ -0,0 +1,40 @@
+#include "vga/rast/dirty_lines.h"
+
+#include "vga/arena.h"
+#include "vga/copy_words.h"
+
+namespace vga {
+namespace rast {
+
+void DirtyLines::enable(unsigned lines) {
+  _lines = lines;
+  _bits = arena_new_array<std::uint32_t>((lines + 31) / 32);
+  clear();
+  mark(0, lines);
+}
+
+void DirtyLines::mark(unsigned first, unsigned count) {
+  if (!_bits) return;
+
+  unsigned end = first + count;
+  if (end > _lines || end < first) end = _lines;
+  for (unsigned line = first; line < end; ++line) {
+    _bits[line / 32] |= 1u << (line % 32);
+  }
+}
+
+void DirtyLines::copy_rows(std::uint32_t const *src, std::uint32_t *dst,
+                           unsigned words_per_line, unsigned lines) {
+  take(lines, [=](unsigned first, unsigned count) {
+    copy_words(src + first * words_per_line,
+               dst + first * words_per_line,
+               count * words_per_line);
+  });
+}
+
+void DirtyLines::clear() {
+  for (unsigned i = 0; i < (_lines + 31) / 32; ++i) _bits[i] = 0;
+}
+
+}  // namespace rast
+}  // namespace vga
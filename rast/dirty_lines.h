@@ -0,0 +1,93 @@
+#ifndef VGA_RAST_DIRTY_LINES_H
+#define VGA_RAST_DIRTY_LINES_H
+
+#include <cstdint>
+
+namespace vga {
+namespace rast {
+
+/*
+ * A set of changed lines in a framebuffer, kept as a bitmap: one bit per line.
+ * Used by the double-buffered rasterizers to bring the back buffer up to date
+ * after a flip by copying only the lines that changed, rather than the whole
+ * page.
+ *
+ * The rasterizers expose it the same way: enable_dirty_tracking (costing a
+ * bit per line of arena), mark_dirty for each change to the background
+ * buffer, and copy_dirty_fg_to_bg, which calls copy_rows once a flip has
+ * taken effect to bring the new background buffer up to date before drawing
+ * on it.
+ *
+ * Until enable is called, every line is considered dirty, so users of this
+ * class fall back to copying everything.
+ */
+class DirtyLines {
+public:
+  DirtyLines() : _bits(nullptr), _lines(0) {}
+
+  /*
+   * Allocates the bitmap, for the given number of lines, from the arena.  All
+   * lines start out dirty.
+   */
+  void enable(unsigned lines);
+
+  bool is_enabled() const { return _bits != nullptr; }
+
+  /*
+   * Marks count lines, starting at first, as dirty.  Lines past the end are
+   * ignored.
+   */
+  void mark(unsigned first, unsigned count = 1);
+
+  /*
+   * Calls fn(first, count) for each run of consecutive dirty lines, in order,
+   * and then clears them all.  If not enabled, calls fn(0, lines) once.
+   */
+  template <typename F>
+  void take(unsigned lines, F &&fn) {
+    if (!_bits) {
+      fn(0u, lines);
+      return;
+    }
+
+    unsigned line = 0;
+    while (line < _lines) {
+      auto &word = _bits[line / 32];
+      if (word == 0 && line % 32 == 0) {
+        line += 32;
+        continue;
+      }
+
+      if (!(word & (1u << (line % 32)))) {
+        ++line;
+        continue;
+      }
+
+      unsigned first = line;
+      while (line < _lines && (_bits[line / 32] & (1u << (line % 32)))) {
+        ++line;
+      }
+      fn(first, line - first);
+    }
+
+    clear();
+  }
+
+  /*
+   * Copies the dirty lines, of a framebuffer lines tall, from src to dst, and
+   * clears them.  Each line is words_per_line words.
+   */
+  void copy_rows(std::uint32_t const *src, std::uint32_t *dst,
+                 unsigned words_per_line, unsigned lines);
+
+private:
+  std::uint32_t *_bits;
+  unsigned _lines;
+
+  void clear();
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_DIRTY_LINES_H
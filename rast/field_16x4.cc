@@ -21,7 +21,10 @@ Field16x4::Field16x4(unsigned width, unsigned height, unsigned top_line)
     _palettes{
       arena_new_array<Pixel>(256),
       arena_new_array<Pixel>(256),
-    } {
+    },
+    _staged_palettes{nullptr, nullptr},
+    _committed_palettes{nullptr, nullptr},
+    _palettes_pended(false) {
   for (unsigned i = 0; i < _width * _height; ++i) {
     _fb[0][i] = 0;
     _fb[1][i] = 0;
@@ -35,6 +38,8 @@ Field16x4::Field16x4(unsigned width, unsigned height, unsigned top_line)
 Field16x4::~Field16x4() {
   _fb[0] = _fb[1] = nullptr;
   _palettes[0] = _palettes[1] = nullptr;
+  _staged_palettes[0] = _staged_palettes[1] = nullptr;
+  _committed_palettes[0] = _committed_palettes[1] = nullptr;
 }
 
 __attribute__((section(".ramcode")))
@@ -49,6 +54,14 @@ auto Field16x4::rasterize(unsigned cycles_per_pixel,
 
   if (ETL_UNLIKELY(line_number == 0)) {
     if (_flip_pended.exchange(false)) flip_now();
+    if (_palettes_pended.exchange(false)) {
+      for (unsigned p = 0; p < 2; ++p) {
+        copy_words(
+            (uint32_t const *) (void const *) _committed_palettes[p],
+            (uint32_t *) (void *) _palettes[p],
+            256 / sizeof(uint32_t));
+      }
+    }
   }
 
   if (ETL_UNLIKELY(line_number >= _height)) {
@@ -68,6 +81,29 @@ auto Field16x4::rasterize(unsigned cycles_per_pixel,
   };
 }
 
+auto Field16x4::get_staged_palette(unsigned index) -> Pixel * {
+  if (!_staged_palettes[0]) {
+    for (unsigned p = 0; p < 2; ++p) {
+      _staged_palettes[p] = arena_new_array<Pixel>(256);
+      _committed_palettes[p] = arena_new_array<Pixel>(256);
+      for (unsigned i = 0; i < 256; ++i) _staged_palettes[p][i] = 0;
+    }
+  }
+  return _staged_palettes[index];
+}
+
+void Field16x4::commit_palettes() {
+  get_staged_palette(0);
+  // As in Palette8::commit_palette.
+  _palettes_pended = false;
+  for (unsigned p = 0; p < 2; ++p) {
+    for (unsigned i = 0; i < 256; ++i) {
+      _committed_palettes[p][i] = _staged_palettes[p][i];
+    }
+  }
+  _palettes_pended = true;
+}
+
 void Field16x4::pend_flip() {
   _flip_pended = true;
 }
@@ -87,12 +87,34 @@ public:
   uint8_t *get_bg_buffer() const { return _fb[!_page1]; }
 
   /*
-   * Returns a pointer to the given palette (0 or 1).
+   * Returns a pointer to the given palette (0 or 1) as used for output.
+   * Changes take effect at the next line rasterized, so making them during
+   * active video splits the screen.  For changes that should appear all at
+   * once, use the staged palettes.
    */
   Pixel * get_palette(unsigned index) {
     return _palettes[index];
   }
 
+  /*
+   * Returns a pointer to the given staged palette (0 or 1), which the
+   * application may change at leisure.  It has no effect on output until
+   * commit_palettes is called.
+   *
+   * As with Palette8, the staged palettes and their committed copies (1 KiB
+   * in all) are only allocated from the arena on the first call to this or
+   * commit_palettes.  The staged palettes start out black.
+   */
+  Pixel * get_staged_palette(unsigned index);
+
+  /*
+   * Arranges for both staged palettes, as they stand now, to be copied into
+   * the palettes in use at the top of the next frame.  Until then, the
+   * previous commit stays on screen, and the staged palettes may be changed
+   * freely.
+   */
+  void commit_palettes();
+
 private:
   unsigned _width;
   unsigned _height;
@@ -101,6 +123,9 @@ private:
   std::atomic<bool> _flip_pended;
   unsigned char *_fb[2];
   Pixel * _palettes[2];
+  Pixel * _staged_palettes[2];
+  Pixel * _committed_palettes[2];
+  std::atomic<bool> _palettes_pended;
 };
 
 }  // namespace rast
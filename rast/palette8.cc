@@ -21,20 +21,41 @@ Palette8::Palette8(unsigned disp_width, unsigned disp_height,
     _fb{arena_new_array<Index>(_width * _height),
         arena_new_array<Index>(_width * _height)},
     _palette{arena_new_array<Pixel>(256)},
-    _page1{false} {
+    _own_palette{_palette},
+    _staged_palette{nullptr},
+    _committed_palette{nullptr},
+    _page1{false},
+    _palette_pended{false} {
 
   for (unsigned i = 0; i < _width * _height; ++i) {
     _fb[0][i] = 0;
     _fb[1][i] = 0;
   }
-  for (unsigned i = 0; i < 256; ++i) {
-    _palette[i] = 0;
-  }
+  for (unsigned i = 0; i < 256; ++i) _palette[i] = 0;
 }
 
 Palette8::~Palette8() {
   _fb[0] = _fb[1] = nullptr;
-  _palette = nullptr;
+  _palette = _own_palette = nullptr;
+  _staged_palette = _committed_palette = nullptr;
+}
+
+auto Palette8::get_staged_palette() -> Pixel * {
+  if (!_staged_palette) {
+    _staged_palette = arena_new_array<Pixel>(256);
+    _committed_palette = arena_new_array<Pixel>(256);
+    for (unsigned i = 0; i < 256; ++i) _staged_palette[i] = 0;
+  }
+  return _staged_palette;
+}
+
+void Palette8::commit_palette() {
+  auto staged = get_staged_palette();
+  // As in Sprites::commit: with the flag clear, rasterize won't touch the
+  // committed copy, so it's ours to overwrite.
+  _palette_pended = false;
+  for (unsigned i = 0; i < 256; ++i) _committed_palette[i] = staged[i];
+  _palette_pended = true;
 }
 
 __attribute__((section(".ramcode")))
@@ -45,6 +66,18 @@ Rasterizer::RasterInfo Palette8::rasterize(unsigned cycles_per_pixel,
   auto repeat = (_scale_y - 1) - (line_number % _scale_y);
   line_number /= _scale_y;
 
+  if (ETL_UNLIKELY(line_number == 0)) {
+    if (_palette_pended.exchange(false)) {
+      // Only ever into our own palette: one from set_palette belongs to the
+      // application.
+      copy_words(
+          (uint32_t const *) (void const *) _committed_palette,
+          (uint32_t *) (void *) _own_palette,
+          256 / sizeof(uint32_t));
+      _palette = _own_palette;
+    }
+  }
+
   if (ETL_UNLIKELY(line_number >= _height)) {
     return { 0, 0, cycles_per_pixel, 0 };
   }
@@ -64,5 +97,12 @@ void Palette8::flip_now() {
   _page1 = !_page1;
 }
 
+void Palette8::copy_dirty_fg_to_bg() {
+  _dirty.copy_rows((uint32_t const *) (void const *) get_fg_buffer(),
+                   (uint32_t *) (void *) get_bg_buffer(),
+                   _width / sizeof(uint32_t),
+                   _height);
+}
+
 }  // namespace rast
 }  // namespace vga
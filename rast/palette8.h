@@ -4,7 +4,9 @@
 #include <atomic>
 #include <cstdint>
 
+#include "vga/graphics_8.h"
 #include "vga/rasterizer.h"
+#include "vga/rast/dirty_lines.h"
 
 namespace vga {
 namespace rast {
@@ -52,9 +54,57 @@ public:
   Index *get_fg_buffer() const { return _fb[_page1]; }
   Index *get_bg_buffer() const { return _fb[!_page1]; }
 
+  /*
+   * Returns a Graphics8 for drawing on the background buffer.
+   */
+  Graphics8 make_bg_graphics() const {
+    return Graphics8(get_bg_buffer(), _width, _height);
+  }
+
+  // Dirty-line tracking for the background buffer; see DirtyLines.
+  void enable_dirty_tracking() { _dirty.enable(_height); }
+  void mark_dirty(unsigned first, unsigned count = 1) {
+    _dirty.mark(first, count);
+  }
+  void copy_dirty_fg_to_bg();
+
+  /*
+   * Returns the palette in use for output.  Changes take effect at the next
+   * line rasterized, so making them during active video splits the screen.
+   * For changes that should appear all at once, use the staged palette.
+   */
   Pixel * get_palette() { return _palette; }
   Pixel const * get_palette() const { return _palette; }
 
+  /*
+   * Returns the staged palette, which the application may change at leisure.
+   * It has no effect on output until commit_palette is called.
+   *
+   * The staged palette, and the copy commit_palette takes of it, are only
+   * allocated from the arena (512 bytes) on the first call to this or
+   * commit_palette, so a Palette8 that never stages pays nothing for them.
+   * The staged palette starts out black.
+   */
+  Pixel * get_staged_palette();
+
+  /*
+   * Arranges for the staged palette, as it stands now, to be copied into the
+   * rasterizer's own palette at the top of the next frame, which then becomes
+   * the palette in use -- replacing any palette given to set_palette.  Until
+   * then, the previous commit stays on screen, and the staged palette may be
+   * changed freely.
+   */
+  void commit_palette();
+
+  /*
+   * Switches to a different palette of 256 entries, which must be word-aligned
+   * and outlive its use.  Takes effect at the next line rasterized.
+   * get_palette returns whichever palette is current, so keep a pointer to the
+   * original if you intend to switch back.  The driver never writes to a
+   * palette given here; commit_palette switches back to the original.
+   */
+  void set_palette(Pixel *palette) { _palette = palette; }
+
 private:
   unsigned _width;
   unsigned _height;
@@ -63,7 +113,12 @@ private:
   unsigned _top_line;
   Index *_fb[2];
   Pixel * _palette;
+  Pixel * _own_palette;
+  Pixel * _staged_palette;
+  Pixel * _committed_palette;
   bool _page1;
+  std::atomic<bool> _palette_pended;
+  DirtyLines _dirty;
 };
 
 }  // namespace rast
@@ -0,0 +1,257 @@
+#include "vga/rast/polygons.h"
+
+#include "etl/assert.h"
+#include "etl/prediction.h"
+
+#include "vga/arena.h"
+
+namespace vga {
+namespace rast {
+
+Polygons::Polygons(unsigned disp_width, unsigned disp_height,
+                   unsigned scale_x, unsigned scale_y,
+                   unsigned max_polygons,
+                   unsigned max_vertices,
+                   unsigned max_spans_per_line,
+                   unsigned top_line)
+  : _width(disp_width / scale_x),
+    _height(disp_height / scale_y),
+    _scale_x(scale_x),
+    _scale_y(scale_y),
+    _top_line(top_line),
+    _max_polygons(max_polygons),
+    _max_vertices(max_vertices),
+    _max_spans_per_line(max_spans_per_line),
+    _vertices(arena_new_array<Point>(max_vertices)),
+    _polygons(arena_new_array<Polygon>(max_polygons)),
+    _vertex_count(0),
+    _polygon_count(0),
+    _staged_background(0),
+    _pages{
+      {
+        arena_new_array<Edge>(max_vertices),
+        arena_new_array<std::uint8_t>(_height),
+        arena_new_array<Span>(_height * max_spans_per_line),
+        0,
+      },
+      {
+        arena_new_array<Edge>(max_vertices),
+        arena_new_array<std::uint8_t>(_height),
+        arena_new_array<Span>(_height * max_spans_per_line),
+        0,
+      },
+    },
+    _page1(false),
+    _flip_pended(false) {
+  ETL_ASSERT(max_vertices <= 65535);
+  ETL_ASSERT(max_spans_per_line <= 255);
+
+  for (auto &p : _pages) {
+    for (unsigned i = 0; i < _height; ++i) p.line_counts[i] = 0;
+  }
+}
+
+Polygons::~Polygons() {
+  _vertices = nullptr;
+  _polygons = nullptr;
+  _pages[0] = _pages[1] = { nullptr, nullptr, nullptr, 0 };
+}
+
+void Polygons::clear() {
+  _vertex_count = 0;
+  _polygon_count = 0;
+}
+
+bool Polygons::add_polygon(Point const *vertices,
+                           unsigned count,
+                           Pixel color) {
+  if (_polygon_count == _max_polygons
+      || count > _max_vertices - _vertex_count) {
+    return false;
+  }
+
+  _polygons[_polygon_count++] = {
+    std::uint16_t(_vertex_count),
+    std::uint16_t(count),
+    color,
+  };
+  for (unsigned i = 0; i < count; ++i) {
+    _vertices[_vertex_count++] = vertices[i];
+  }
+  return true;
+}
+
+void Polygons::commit() {
+  // Claim the back page, as in Sprites::commit.
+  _flip_pended = false;
+  auto &page = _pages[!_page1];
+
+  page.background = _staged_background;
+  for (unsigned i = 0; i < _height; ++i) page.line_counts[i] = 0;
+
+  unsigned edge_count = 0;
+  for (unsigned i = 0; i < _polygon_count; ++i) {
+    add_edges(page, _polygons[i], edge_count);
+  }
+
+  _flip_pended = true;
+}
+
+void Polygons::add_edges(Page &page,
+                         Polygon const &polygon,
+                         unsigned &edge_count) {
+  unsigned const n = polygon.vertex_count;
+  if (n < 3) return;
+
+  auto const *v = _vertices + polygon.first_vertex;
+
+  unsigned top = 0;
+  for (unsigned i = 1; i < n; ++i) {
+    if (v[i].y < v[top].y) top = i;
+  }
+
+  // A convex polygon's boundary splits, at its top vertex, into two chains
+  // that run down to its bottom vertex.  Walk each of them, forward and
+  // backward around the polygon, recording its non-horizontal edges in order.
+  // (Edges that run upward mean the polygon isn't convex; they're skipped.)
+  unsigned chain_start[2];
+  for (unsigned c = 0; c < 2; ++c) {
+    chain_start[c] = edge_count;
+    unsigned i = top;
+    for (unsigned k = 0; k < n; ++k) {
+      unsigned j = c == 0 ? (i + 1) % n : (i + n - 1) % n;
+      auto const &p0 = v[i], &p1 = v[j];
+      if (p1.y < p0.y) break;
+      if (p1.y > p0.y) {
+        page.edges[edge_count++] = {
+          p0.x * 0x10000,
+          std::int64_t(p1.x - p0.x) * 0x10000 / (p1.y - p0.y),
+          std::int16_t(p0.y),
+          std::int16_t(p1.y),
+          polygon.color,
+        };
+      }
+      i = j;
+    }
+  }
+
+  // Both chains must reach the same bottom line, or the polygon was concave
+  // or degenerate.
+  unsigned const a_end = chain_start[1], b_end = edge_count;
+  if (a_end == chain_start[0] || b_end == chain_start[1]
+      || page.edges[a_end - 1].bottom != page.edges[b_end - 1].bottom) {
+    edge_count = chain_start[0];
+    return;
+  }
+
+  int y = v[top].y < 0 ? 0 : v[top].y;
+  int bottom = page.edges[a_end - 1].bottom;
+  if (bottom > int(_height)) bottom = _height;
+
+  unsigned a = chain_start[0], b = chain_start[1];
+  for (; y < bottom; ++y) {
+    while (page.edges[a].bottom <= y) ++a;
+    while (page.edges[b].bottom <= y) ++b;
+
+    auto &count = page.line_counts[y];
+    if (count < _max_spans_per_line) {
+      page.line_spans[y * _max_spans_per_line + count] = {
+        std::uint16_t(a),
+        std::uint16_t(b),
+      };
+      ++count;
+    }
+  }
+}
+
+void Polygons::flip_now() {
+  _page1 = !_page1;
+}
+
+__attribute__((section(".ramcode")))
+static void fill(Rasterizer::Pixel *target,
+                 unsigned from,
+                 unsigned to,
+                 Rasterizer::Pixel color) {
+  while (from < to && (from & 3)) target[from++] = color;
+
+  auto word = color * 0x01010101u;
+  auto *w = reinterpret_cast<std::uint32_t *>(target + from);
+  for (; from + 4 <= to; from += 4) *w++ = word;
+
+  while (from < to) target[from++] = color;
+}
+
+// Finds the first pixel at or right of a 16.16 x coordinate, clipped to the
+// line.
+__attribute__((section(".ramcode")))
+static unsigned first_pixel_at(std::int64_t x, unsigned width) {
+  if (x <= 0) return 0;
+  if (x >= std::int64_t(width) << 16) return width;
+  return (unsigned(x) + 0xFFFF) >> 16;
+}
+
+__attribute__((section(".ramcode")))
+auto Polygons::rasterize(unsigned cycles_per_pixel,
+                         unsigned line_number,
+                         Pixel *target) -> RasterInfo {
+  line_number -= _top_line;
+  auto repeat = (_scale_y - 1) - (line_number % _scale_y);
+  line_number /= _scale_y;
+
+  if (ETL_UNLIKELY(line_number == 0)) {
+    if (_flip_pended.exchange(false)) flip_now();
+  }
+
+  if (ETL_UNLIKELY(line_number >= _height)) {
+    return { 0, 0, cycles_per_pixel, 0 };
+  }
+
+  auto const &page = _pages[_page1];
+  unsigned n = page.line_counts[line_number];
+
+  if (n == 0) {
+    // Stretch a single pixel across the line, like SolidColor.
+    target[0] = page.background;
+    return {
+      .offset = 0,
+      .length = 1,
+      .cycles_per_pixel = cycles_per_pixel * _scale_x * _width,
+      .repeat_lines = repeat,
+    };
+  }
+
+  fill(target, 0, _width, page.background);
+
+  auto const *spans = page.line_spans + line_number * _max_spans_per_line;
+  int const y = line_number;
+
+  // Spans are in display list order, so later polygons land on top.
+  for (unsigned i = 0; i < n; ++i) {
+    auto const &ea = page.edges[spans[i].a];
+    auto const &eb = page.edges[spans[i].b];
+
+    // Between an edge's ends, x stays within the coordinate range, but the
+    // product on the way there may not fit in 32 bits.
+    std::int64_t xa = ea.x + (y - ea.top) * ea.slope;
+    std::int64_t xb = eb.x + (y - eb.top) * eb.slope;
+    if (xa > xb) {
+      auto t = xa;
+      xa = xb;
+      xb = t;
+    }
+
+    fill(target, first_pixel_at(xa, _width), first_pixel_at(xb, _width),
+         ea.color);
+  }
+
+  return {
+    .offset = 0,
+    .length = _width,
+    .cycles_per_pixel = cycles_per_pixel * _scale_x,
+    .repeat_lines = repeat,
+  };
+}
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,152 @@
+#ifndef VGA_RAST_POLYGONS_H
+#define VGA_RAST_POLYGONS_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "vga/rasterizer.h"
+
+namespace vga {
+namespace rast {
+
+/*
+ * Draws flat-shaded convex polygons one scanline at a time, without a
+ * framebuffer.  This suits vector and 3D displays that would otherwise need a
+ * double-buffered Direct: memory use is proportional to the complexity of the
+ * scene, not the size of the screen, and since each line is drawn just before
+ * it's scanned out, there's nothing to tear.
+ *
+ * The application builds a display list -- clear, then add_polygon for each
+ * polygon, back to front -- and calls commit.  commit turns the list into an
+ * edge table, recording for each line which pairs of edges bound a span.
+ * rasterize then only has to evaluate those edges and fill between them.
+ *
+ * Coordinates are in the rasterizer's pixels (that is, after scaling) and may
+ * lie off-screen, within +/-32767.  A pixel is filled if its top-left corner
+ * is inside the polygon, so polygons that share an edge neither overlap nor
+ * leave gaps.
+ *
+ * Each line can hold at most max_spans_per_line spans; beyond that, the last
+ * polygons in the display list drop out of that line.
+ */
+class Polygons : public Rasterizer {
+public:
+  struct Point {
+    int x;
+    int y;
+  };
+
+  /*
+   * Creates a polygon renderer with the given configuration:
+   * - disp_width and disp_height give the native size of the display, e.g.
+   *   800x600.
+   * - scale_x and scale_y give the subdivision factors, as for Direct.
+   * - max_polygons and max_vertices bound the display list.  max_vertices is
+   *   the total over all polygons, and at most 65535.
+   * - max_spans_per_line is at most 255.
+   * - top_line applies an offset to the start of rasterization, for use when
+   *   this rasterizer starts somewhere other than the top of the display.
+   *
+   * The display starts out empty, filled with color 0.
+   */
+  Polygons(unsigned disp_width, unsigned disp_height,
+           unsigned scale_x, unsigned scale_y,
+           unsigned max_polygons,
+           unsigned max_vertices,
+           unsigned max_spans_per_line,
+           unsigned top_line = 0);
+  ~Polygons();
+
+  RasterInfo rasterize(unsigned, unsigned, Pixel *) override;
+
+  unsigned get_width() const { return _width; }
+  unsigned get_height() const { return _height; }
+
+  /*
+   * Empties the display list.
+   */
+  void clear();
+
+  /*
+   * Sets the color of pixels not covered by any polygon.
+   */
+  void set_background(Pixel color) { _staged_background = color; }
+
+  /*
+   * Appends a convex polygon, given by count vertices in order (either
+   * winding), to the display list.  It is drawn over those added before it.
+   * The vertices are copied.  Returns false, and adds nothing, if the display
+   * list is full.
+   */
+  bool add_polygon(Point const *vertices, unsigned count, Pixel color);
+
+  /*
+   * Builds the edge table for the display list as it currently stands and
+   * arranges for it to be displayed starting at the next frame.  Until then,
+   * the previous commit stays on screen.  This is safe to call at any time,
+   * but its cost grows with the area of the polygons, so vertical blank is a
+   * good time.
+   */
+  void commit();
+
+private:
+  struct Polygon {
+    std::uint16_t first_vertex;
+    std::uint16_t vertex_count;
+    Pixel color;
+  };
+
+  // A non-horizontal polygon edge, covering lines [top, bottom).  Its x
+  // coordinate at line y is x + (y - top) * slope, in 16.16 fixed point.
+  // x is 16.16 fixed point.  The slope, in the same units per line, is kept
+  // in 64 bits: a nearly flat edge across the full coordinate range can move
+  // 65534 pixels in one line, which doesn't fit in 16.16.
+  struct Edge {
+    std::int32_t x;
+    std::int64_t slope;
+    std::int16_t top;
+    std::int16_t bottom;
+    Pixel color;
+  };
+
+  // The edges bounding one span on a line.
+  struct Span {
+    std::uint16_t a;
+    std::uint16_t b;
+  };
+
+  struct Page {
+    Edge *edges;
+    // For each line, the number of spans on it, then the spans.
+    std::uint8_t *line_counts;
+    Span *line_spans;
+    Pixel background;
+  };
+
+  unsigned _width;
+  unsigned _height;
+  unsigned _scale_x;
+  unsigned _scale_y;
+  unsigned _top_line;
+  unsigned _max_polygons;
+  unsigned _max_vertices;
+  unsigned _max_spans_per_line;
+
+  Point *_vertices;
+  Polygon *_polygons;
+  unsigned _vertex_count;
+  unsigned _polygon_count;
+  Pixel _staged_background;
+
+  Page _pages[2];
+  bool _page1;
+  std::atomic<bool> _flip_pended;
+
+  void add_edges(Page &, Polygon const &, unsigned &edge_count);
+  void flip_now();
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_POLYGONS_H
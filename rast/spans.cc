@@ -0,0 +1,167 @@
+#include "vga/rast/spans.h"
+
+#include "etl/assert.h"
+#include "etl/prediction.h"
+
+#include "vga/arena.h"
+#include "vga/copy_words.h"
+#include "vga/scan.h"
+
+using etl::armv7m::Word;
+
+namespace vga {
+namespace rast {
+
+// Padding on either side of the scratch buffer, matching what the driver
+// gives rasterizers in its own working buffers.
+static constexpr unsigned pad_words = scan::extra_pad_words;
+
+Spans::Spans(Span const *spans, unsigned count)
+  : _count(count),
+    _spans(arena_new_array<Span>(count)),
+    // Allocated as words to get word alignment.
+    _scratch(reinterpret_cast<Pixel *>(arena_new_array<Word>(
+          pad_words * 2 + scan::max_pixels_per_line / sizeof(Word)))
+        + pad_words * sizeof(Word)) {
+  unsigned total = 0;
+  for (unsigned i = 0; i < count; ++i) {
+    _spans[i] = spans[i];
+    total += spans[i].width;
+  }
+  ETL_ASSERT(total <= scan::max_pixels_per_line);
+}
+
+Spans::~Spans() {
+  _spans = nullptr;
+  _scratch = nullptr;
+  _count = 0;
+}
+
+/*
+ * Moves a span's output from src into the span's place at out, which is width
+ * pixels long: blanking or skipping for its offset, replicating each pixel
+ * scale times, and clipping.  Reads run ahead of writes, so src may be out
+ * itself if the offset is negative and scale is 1.
+ */
+__attribute__((section(".ramcode")))
+static void place_forward(Pixel const *src, Rasterizer::RasterInfo const &ri,
+                          unsigned scale, Pixel *out, unsigned width) {
+  Pixel *end = out + width;
+  Pixel const *src_end = src + ri.length;
+
+  // Blank the offset, or skip pixels if it's negative.
+  if (ri.offset >= 0) {
+    for (int i = 0; i < ri.offset && out != end; ++i) *out++ = 0;
+  } else {
+    unsigned skip = unsigned(-ri.offset);
+    src += skip / scale;
+    // Partially visible pixel at the left edge.
+    unsigned partial = skip % scale;
+    if (partial && src < src_end) {
+      for (unsigned i = partial; i < scale && out != end; ++i) *out++ = *src;
+      ++src;
+    }
+  }
+
+  if (scale == 1) {
+    while (out != end && src < src_end) *out++ = *src++;
+  } else {
+    while (out != end && src < src_end) {
+      Pixel p = *src++;
+      for (unsigned i = 0; i < scale && out != end; ++i) *out++ = p;
+    }
+  }
+
+  // Blank whatever the span didn't cover.
+  while (out != end) *out++ = 0;
+}
+
+/*
+ * Like place_forward, for a span rendered in place at out with a non-negative
+ * offset.  Every output pixel comes from at or before its own position, so we
+ * work from the right.
+ */
+__attribute__((section(".ramcode")))
+static void place_backward(Rasterizer::RasterInfo const &ri, unsigned scale,
+                           Pixel *out, unsigned width) {
+  unsigned offset = unsigned(ri.offset);
+  unsigned covered = offset + ri.length * scale;
+  if (covered > width) covered = width;
+
+  for (unsigned i = width; i > covered; --i) out[i - 1] = 0;
+  // The common case -- output already exactly where it belongs -- has
+  // nothing left to do.
+  if (offset == 0 && scale == 1) return;
+  for (unsigned i = covered; i > offset; --i) {
+    out[i - 1] = out[(i - 1 - offset) / scale];
+  }
+  for (unsigned i = 0; i < offset && i < width; ++i) out[i] = 0;
+}
+
+__attribute__((section(".ramcode")))
+Rasterizer::RasterInfo Spans::rasterize(unsigned cycles_per_pixel,
+                                        unsigned line_number,
+                                        Pixel *raster_target) {
+  unsigned x = 0;
+  unsigned repeat = ~0U;
+
+  for (unsigned s = 0; s < _count; ++s) {
+    auto const &span = _spans[s];
+    Pixel *out = raster_target + x;
+    x += span.width;
+
+    if (ETL_UNLIKELY(!span.rasterizer)) {
+      for (unsigned i = 0; i < span.width; ++i) out[i] = 0;
+      continue;
+    }
+
+    // Rasterizers store whole words, so a span starting on a word boundary
+    // can be drawn straight into the line.  Anything it draws past the end of
+    // the span lands on spans to the right, which haven't been drawn yet;
+    // anything it scribbles into the pad to its left would land on the span
+    // we just drew, so we put that back afterwards.
+    bool in_place = (x - span.width) % sizeof(Word) == 0;
+
+    Rasterizer::RasterInfo ri;
+    if (in_place) {
+      auto pad = reinterpret_cast<Word *>(out) - pad_words;
+      Word saved[pad_words];
+      for (unsigned i = 0; i < pad_words; ++i) saved[i] = pad[i];
+      ri = span.rasterizer->rasterize(cycles_per_pixel, line_number, out);
+      for (unsigned i = 0; i < pad_words; ++i) pad[i] = saved[i];
+    } else {
+      ri = span.rasterizer->rasterize(cycles_per_pixel, line_number, _scratch);
+    }
+    if (ri.repeat_lines < repeat) repeat = ri.repeat_lines;
+
+    // Each pixel produced by the span covers 'scale' pixels of ours.
+    unsigned scale = (ri.cycles_per_pixel + cycles_per_pixel / 2)
+                   / cycles_per_pixel;
+    if (scale == 0) scale = 1;
+
+    if (!in_place) {
+      place_forward(_scratch, ri, scale, out, span.width);
+    } else if (ri.offset >= 0) {
+      place_backward(ri, scale, out, span.width);
+    } else if (scale == 1) {
+      place_forward(out, ri, scale, out, span.width);
+    } else {
+      // Replicating pixels while skipping some: output overtakes input
+      // partway along, so neither direction works in place.
+      copy_words(reinterpret_cast<Word const *>(out),
+                 reinterpret_cast<Word *>(_scratch),
+                 (ri.length + sizeof(Word) - 1) / sizeof(Word));
+      place_forward(_scratch, ri, scale, out, span.width);
+    }
+  }
+
+  return {
+    .offset = 0,
+    .length = x,
+    .cycles_per_pixel = cycles_per_pixel,
+    .repeat_lines = repeat,
+  };
+}
+
+}  // namespace rast
+}  // namespace vga
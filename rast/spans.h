@@ -0,0 +1,67 @@
+#ifndef VGA_RAST_SPANS_H
+#define VGA_RAST_SPANS_H
+
+#include <cstdint>
+
+#include "vga/rasterizer.h"
+
+namespace vga {
+namespace rast {
+
+/*
+ * A rasterizer that divides each line horizontally into spans, each handled by
+ * a Rasterizer of its own.  This is the horizontal counterpart to Bands: for
+ * example, a Text_10x16 status pane on the left and a Direct viewport on the
+ * right.
+ *
+ * Each span's Rasterizer must be set up for the span's width -- it may write
+ * no more than width pixels, plus the usual few words of slop on either side
+ * (scan::extra_pad_words).  Spans starting on a word boundary are drawn
+ * straight into the line; others go through a scratch buffer.  Either way,
+ * Spans then moves the result into place, honoring the offset the rasterizer
+ * asked for and clipping it to the span.  A span may ask for cycles_per_pixel
+ * that's a multiple of the mode's (as Direct and SolidColor do to stretch
+ * pixels horizontally); Spans replicates its pixels to match.  Other ratios
+ * are rounded to the nearest multiple.
+ *
+ * The result repeats for as many lines as the span that wants the fewest.
+ */
+class Spans : public Rasterizer {
+public:
+  struct Span {
+    // Rasterizer for this span, or nullptr to leave it black.
+    Rasterizer *rasterizer;
+    // Width of the span, in pixels of the display mode.
+    unsigned width;
+  };
+
+  /*
+   * Creates a Spans from the given array of spans, laid out from left to
+   * right.  The array is copied, so it needn't outlive the constructor.  The
+   * spans' widths may total at most scan::max_pixels_per_line.
+   */
+  Spans(Span const *spans, unsigned count);
+  ~Spans();
+
+  RasterInfo rasterize(unsigned, unsigned, Pixel *) override;
+
+  unsigned get_span_count() const { return _count; }
+
+  /*
+   * Replaces the rasterizer for one span.  Like changing a Band, this is safe
+   * during vertical blank.
+   */
+  void set_rasterizer(unsigned index, Rasterizer *r) {
+    _spans[index].rasterizer = r;
+  }
+
+private:
+  unsigned _count;
+  Span *_spans;
+  Pixel *_scratch;
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_SPANS_H
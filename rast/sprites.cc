@@ -0,0 +1,149 @@
+#include "vga/rast/sprites.h"
+
+#include "etl/assert.h"
+#include "etl/prediction.h"
+
+#include "vga/arena.h"
+
+namespace vga {
+namespace rast {
+
+Sprites::Sprites(Rasterizer &background,
+                 unsigned sprite_count,
+                 unsigned max_per_line,
+                 unsigned height,
+                 Pixel transparent,
+                 unsigned top_line)
+  : _background(background),
+    _count(sprite_count),
+    _max_per_line(max_per_line),
+    _height(height),
+    _top_line(top_line),
+    _transparent(transparent),
+    _staged(arena_new_array<Sprite>(sprite_count)),
+    _pages{
+      {
+        arena_new_array<Sprite>(sprite_count),
+        arena_new_array<std::uint8_t>(height),
+        arena_new_array<std::uint8_t>(height * max_per_line),
+      },
+      {
+        arena_new_array<Sprite>(sprite_count),
+        arena_new_array<std::uint8_t>(height),
+        arena_new_array<std::uint8_t>(height * max_per_line),
+      },
+    },
+    _page1(false),
+    _flip_pended(false) {
+  ETL_ASSERT(sprite_count <= 255);
+
+  for (unsigned i = 0; i < sprite_count; ++i) {
+    _staged[i] = { nullptr, 0, 0, 0, 0 };
+  }
+  for (auto &p : _pages) {
+    for (unsigned i = 0; i < height; ++i) p.line_counts[i] = 0;
+  }
+}
+
+Sprites::~Sprites() {
+  _staged = nullptr;
+  _pages[0] = _pages[1] = { nullptr, nullptr, nullptr };
+  _count = 0;
+}
+
+void Sprites::commit() {
+  // Claim the back page.  If a previous commit hasn't taken effect yet, this
+  // cancels it, so the back page is still ours; if it has, the back page is
+  // the old front page, which rasterize has stopped using.  Either way,
+  // rasterize won't flip until we set the flag again.
+  _flip_pended = false;
+  auto &page = _pages[!_page1];
+
+  for (unsigned i = 0; i < _height; ++i) page.line_counts[i] = 0;
+
+  // Bucket each sprite into the lines it intersects.  Walking sprites in order
+  // leaves each line's list sorted by sprite number.
+  for (unsigned s = 0; s < _count; ++s) {
+    auto const &sprite = page.sprites[s] = _staged[s];
+    if (!sprite.pixels || sprite.width == 0) continue;
+
+    int top = sprite.y < 0 ? 0 : sprite.y;
+    int bottom = sprite.y + int(sprite.height);
+    if (bottom > int(_height)) bottom = _height;
+
+    for (int line = top; line < bottom; ++line) {
+      auto &n = page.line_counts[line];
+      if (n < _max_per_line) {
+        page.line_sprites[line * _max_per_line + n] = s;
+        ++n;
+      }
+    }
+  }
+
+  _flip_pended = true;
+}
+
+void Sprites::flip_now() {
+  _page1 = !_page1;
+}
+
+__attribute__((section(".ramcode")))
+auto Sprites::rasterize(unsigned cycles_per_pixel,
+                        unsigned line_number,
+                        Pixel *target) -> RasterInfo {
+  auto ri = _background.rasterize(cycles_per_pixel, line_number, target);
+
+  line_number -= _top_line;
+
+  if (ETL_UNLIKELY(line_number == 0)) {
+    if (_flip_pended.exchange(false)) flip_now();
+  }
+
+  if (ETL_UNLIKELY(line_number >= _height)) return ri;
+
+  auto const &page = _pages[_page1];
+  unsigned n = page.line_counts[line_number];
+
+  if (n == 0) {
+    // Let the background repeat this line, but not into a line with sprites.
+    for (unsigned i = 1; i <= ri.repeat_lines; ++i) {
+      if (line_number + i >= _height || page.line_counts[line_number + i]) {
+        ri.repeat_lines = i - 1;
+        break;
+      }
+    }
+    return ri;
+  }
+
+  // Sprites differ from line to line.
+  ri.repeat_lines = 0;
+
+  // Sprite x positions count from the first pixel the background produced,
+  // so that had better be at the left edge.
+  ETL_ASSERT(ri.offset == 0);
+
+  auto const *indices = page.line_sprites + line_number * _max_per_line;
+  int const length = ri.length;
+
+  // Draw back to front, so that lower numbers land on top.
+  while (n--) {
+    auto const &sprite = page.sprites[indices[n]];
+
+    int x0 = sprite.x < 0 ? 0 : sprite.x;
+    int x1 = sprite.x + int(sprite.width);
+    if (x1 > length) x1 = length;
+
+    auto const *src = sprite.pixels
+                    + (int(line_number) - sprite.y) * sprite.width
+                    - sprite.x;
+    for (int x = x0; x < x1; ++x) {
+      Pixel p = src[x];
+      if (p != _transparent) target[x] = p;
+    }
+  }
+
+  return ri;
+}
+
+}  // namespace rast
+}  // namespace vga
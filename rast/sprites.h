@@ -0,0 +1,110 @@
+#ifndef VGA_RAST_SPRITES_H
+#define VGA_RAST_SPRITES_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "vga/rasterizer.h"
+
+namespace vga {
+namespace rast {
+
+/*
+ * A sprite layer that decorates the output of another Rasterizer -- typically
+ * Direct or Palette8 -- with 8bpp sprites.  Moving an object no longer means
+ * redrawing and flipping a whole framebuffer page.
+ *
+ * Horizontally, sprite positions and pixels are in the background's pixels:
+ * if the background stretches pixels, so do the sprites.  x = 0 is the first
+ * pixel the background produces, which must be at the left edge of the line
+ * (offset 0, checked on lines with sprites), and sprites are clipped to the
+ * pixels it produces.  So the background should produce full-width lines:
+ * Direct, Palette8, Bitmap_1 and Tilemap do, but where a background collapses
+ * a line into one stretched pixel -- SolidColor, or Polygons on a line with no
+ * polygons -- sprites on that line don't show.  Vertically they're
+ * in display lines, counted from top_line, whatever the background's line
+ * repeats -- a sprite over a line-doubled Direct is half as tall as its image
+ * would be in the framebuffer, and lines with sprites on them aren't repeated.
+ * Each sprite is a rectangle of Pixels, with one value (chosen at
+ * construction) treated as transparent.  Lower-numbered sprites are drawn on
+ * top.
+ *
+ * To keep rasterization cheap, sprites are bucket-sorted by line when the
+ * application calls commit, so each line only looks at the sprites that
+ * intersect it.  Each line shows at most max_per_line sprites; beyond that the
+ * highest-numbered sprites drop out.
+ */
+class Sprites : public Rasterizer {
+public:
+  struct Sprite {
+    // Pixels, row-major, width * height of them.  nullptr hides the sprite.
+    Pixel const *pixels;
+    unsigned width;
+    unsigned height;
+    // Position of the top-left corner.  May be off-screen in any direction.
+    int x;
+    int y;
+  };
+
+  /*
+   * Creates a sprite layer over background, with the given configuration:
+   * - sprite_count is the number of sprites, at most 255.
+   * - max_per_line limits how many sprites may appear on a single line.
+   * - height is the number of lines the layer covers, starting at top_line.
+   * - transparent is the Pixel value that lets the background show through.
+   *
+   * All sprites start out hidden.
+   */
+  Sprites(Rasterizer &background,
+          unsigned sprite_count,
+          unsigned max_per_line,
+          unsigned height,
+          Pixel transparent = 0,
+          unsigned top_line = 0);
+  ~Sprites();
+
+  RasterInfo rasterize(unsigned, unsigned, Pixel *) override;
+
+  unsigned get_sprite_count() const { return _count; }
+
+  /*
+   * Returns the application's copy of a sprite.  Changes have no effect until
+   * commit is called.
+   */
+  Sprite &get_sprite(unsigned index) { return _staged[index]; }
+  Sprite const &get_sprite(unsigned index) const { return _staged[index]; }
+
+  /*
+   * Sorts the sprites as they currently stand and arranges for them to be
+   * displayed starting at the next frame.  Until then, the previous commit
+   * stays on screen.  This is safe to call at any time, but it takes a while,
+   * so vertical blank is a good time.
+   */
+  void commit();
+
+private:
+  struct Page {
+    Sprite *sprites;
+    // For each line, the number of sprites on it, then their indices.
+    std::uint8_t *line_counts;
+    std::uint8_t *line_sprites;
+  };
+
+  Rasterizer &_background;
+  unsigned _count;
+  unsigned _max_per_line;
+  unsigned _height;
+  unsigned _top_line;
+  Pixel _transparent;
+  Sprite *_staged;
+  Page _pages[2];
+  bool _page1;
+  std::atomic<bool> _flip_pended;
+
+  void flip_now();
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_SPRITES_H
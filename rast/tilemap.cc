@@ -0,0 +1,129 @@
+#include "vga/rast/tilemap.h"
+
+#include "etl/assert.h"
+#include "etl/prediction.h"
+
+#include "vga/arena.h"
+
+namespace vga {
+namespace rast {
+
+// Reduces v modulo m, for possibly-negative v.
+static inline unsigned wrap(int v, unsigned m) {
+  int r = v % int(m);
+  return unsigned(r < 0 ? r + int(m) : r);
+}
+
+Tilemap::Tilemap(unsigned disp_width, unsigned disp_height,
+                 unsigned scale_x, unsigned scale_y,
+                 unsigned tile_size,
+                 unsigned map_cols, unsigned map_rows,
+                 unsigned tile_count,
+                 unsigned top_line)
+  : _width(disp_width / scale_x),
+    _height(disp_height / scale_y),
+    _scale_x(scale_x),
+    _scale_y(scale_y),
+    _top_line(top_line),
+    _tile_size(tile_size),
+    _map_cols(map_cols),
+    _map_rows(map_rows),
+    _tiles(arena_new_array<Pixel>(tile_count * tile_size * tile_size)),
+    _map(arena_new_array<std::uint8_t>(map_cols * map_rows)),
+    _scroll_x(0),
+    _scroll_y(0),
+    _line_scroll_x(nullptr),
+    _line_scroll_y(nullptr) {
+  // Tile rows are copied in whole words.
+  ETL_ASSERT(tile_size == 8 || tile_size == 16);
+  ETL_ASSERT(tile_count <= 256);
+
+  for (unsigned i = 0; i < tile_count * tile_size * tile_size; ++i) {
+    _tiles[i] = 0;
+  }
+  for (unsigned i = 0; i < map_cols * map_rows; ++i) {
+    _map[i] = 0;
+  }
+}
+
+Tilemap::~Tilemap() {
+  _tiles = nullptr;
+  _map = nullptr;
+}
+
+__attribute__((section(".ramcode")))
+auto Tilemap::rasterize(unsigned cycles_per_pixel,
+                        unsigned line_number,
+                        Pixel *target) -> RasterInfo {
+  line_number -= _top_line;
+  auto repeat = (_scale_y - 1) - (line_number % _scale_y);
+  line_number /= _scale_y;
+
+  if (ETL_UNLIKELY(line_number >= _height)) {
+    return { 0, 0, cycles_per_pixel, 0 };
+  }
+
+  int x = _scroll_x;
+  int y = _scroll_y + int(line_number);
+  if (_line_scroll_x) x += _line_scroll_x[line_number];
+  if (_line_scroll_y) y += _line_scroll_y[line_number];
+
+  unsigned const ts = _tile_size;
+  unsigned const words_per_row = ts / sizeof(std::uint32_t);
+
+  unsigned py = wrap(y, _map_rows * ts);
+  unsigned px = wrap(x, _map_cols * ts);
+
+  std::uint8_t const *map_row = _map + (py / ts) * _map_cols;
+  Pixel const *tile_rows = _tiles + (py % ts) * ts;
+  unsigned col = px / ts;
+
+  // The tile rows and the target are both word-aligned, but the line can
+  // start anywhere within a tile.  We treat the tile rows along the line as
+  // one stream of words, starting with the word holding the first visible
+  // pixel, and funnel-shift it into aligned output words (as shift_words
+  // does) -- so every store is a whole aligned word.
+  auto tile_row = [&] {
+    return reinterpret_cast<std::uint32_t const *>(
+        static_cast<void const *>(tile_rows + map_row[col] * ts * ts));
+  };
+
+  auto *dst = reinterpret_cast<std::uint32_t *>(static_cast<void *>(target));
+  auto *const end = dst + (_width + sizeof(std::uint32_t) - 1)
+                        / sizeof(std::uint32_t);
+  unsigned const skip = px % ts;
+  unsigned const shift = (skip % sizeof(std::uint32_t)) * 8;
+  unsigned i = skip / sizeof(std::uint32_t);
+  auto const *src = tile_row();
+
+  auto next_tile = [&] {
+    if (++col == _map_cols) col = 0;
+    src = tile_row();
+    i = 0;
+  };
+
+  if (shift == 0) {
+    while (dst != end) {
+      if (i == words_per_row) next_tile();
+      *dst++ = src[i++];
+    }
+  } else {
+    std::uint32_t prev = src[i++];
+    while (dst != end) {
+      if (i == words_per_row) next_tile();
+      std::uint32_t next = src[i++];
+      *dst++ = (prev >> shift) | (next << (32 - shift));
+      prev = next;
+    }
+  }
+
+  return {
+    .offset = 0,
+    .length = _width,
+    .cycles_per_pixel = cycles_per_pixel * _scale_x,
+    .repeat_lines = repeat,
+  };
+}
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,109 @@
+#ifndef VGA_RAST_TILEMAP_H
+#define VGA_RAST_TILEMAP_H
+
+#include <cstdint>
+
+#include "vga/rasterizer.h"
+
+namespace vga {
+namespace rast {
+
+/*
+ * A tiled-graphics rasterizer: the screen is assembled from square 8bpp tiles,
+ * 8x8 or 16x16 pixels, as directed by a map of tile indices.  The map may be
+ * larger than the screen and is scrolled with pixel precision, wrapping at its
+ * edges.  Per-line scroll tables allow for parallax and similar effects.
+ *
+ * Like Direct, pixels can be multiplied on both axes; a 400x300 screen of 8x8
+ * tiles needs a 50x38 byte map plus the tile set, instead of two 120KB pages.
+ *
+ * Tile rows are copied a word at a time, funnel-shifted into alignment when
+ * the scroll position isn't a multiple of four pixels, so the output is all
+ * aligned word stores.  The last may run up to three pixels past the right
+ * end of the line, into the padding the driver leaves there.
+ */
+class Tilemap : public Rasterizer {
+public:
+  /*
+   * Creates a Tilemap with the given configuration:
+   * - disp_width and disp_height give the native size of the display, e.g.
+   *   800x600.
+   * - scale_x and scale_y give the subdivision factors, as for Direct.
+   * - tile_size is 8 or 16.
+   * - map_cols and map_rows give the size of the map, in tiles.
+   * - tile_count is the number of tiles in the set, at most 256.
+   * - top_line applies an offset to the start of rasterization, for use when
+   *   this rasterizer starts somewhere other than the top of the display.
+   *
+   * The tile set and map are allocated from the arena and start out zeroed.
+   */
+  Tilemap(unsigned disp_width, unsigned disp_height,
+          unsigned scale_x, unsigned scale_y,
+          unsigned tile_size,
+          unsigned map_cols, unsigned map_rows,
+          unsigned tile_count,
+          unsigned top_line = 0);
+  ~Tilemap();
+
+  RasterInfo rasterize(unsigned, unsigned, Pixel *) override;
+
+  unsigned get_width() const { return _width; }
+  unsigned get_height() const { return _height; }
+  unsigned get_tile_size() const { return _tile_size; }
+  unsigned get_map_cols() const { return _map_cols; }
+  unsigned get_map_rows() const { return _map_rows; }
+
+  /*
+   * Returns the pixels of a tile: tile_size rows of tile_size Pixels.
+   */
+  Pixel *get_tile(unsigned index) {
+    return _tiles + index * _tile_size * _tile_size;
+  }
+
+  /*
+   * Returns the map: map_rows rows of map_cols tile indices.
+   */
+  std::uint8_t *get_map() { return _map; }
+
+  /*
+   * Sets the position of the map, in (unmultiplied) pixels, that appears at
+   * the top-left corner of the screen.  Any value is fine; the map wraps.
+   */
+  void set_scroll(int x, int y) {
+    _scroll_x = x;
+    _scroll_y = y;
+  }
+
+  /*
+   * Sets tables of additional scroll offsets, one entry per (unmultiplied)
+   * line of the screen, which are added to the values given to set_scroll.
+   * Either may be nullptr.  The tables are used in place, so they may be
+   * altered to animate the effect, and must outlive their use.
+   */
+  void set_line_scroll(std::int16_t const *x_table,
+                       std::int16_t const *y_table) {
+    _line_scroll_x = x_table;
+    _line_scroll_y = y_table;
+  }
+
+private:
+  unsigned _width;
+  unsigned _height;
+  unsigned _scale_x;
+  unsigned _scale_y;
+  unsigned _top_line;
+  unsigned _tile_size;
+  unsigned _map_cols;
+  unsigned _map_rows;
+  Pixel *_tiles;
+  std::uint8_t *_map;
+  int _scroll_x;
+  int _scroll_y;
+  std::int16_t const *_line_scroll_x;
+  std::int16_t const *_line_scroll_y;
+};
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_TILEMAP_H
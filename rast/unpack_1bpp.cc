@@ -0,0 +1,33 @@
+#include "vga/rast/unpack_1bpp.h"
+
+// C++ version of unpack_1bpp.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_1bpp_reference(std::uint32_t const *input_line,
+                           std::uint8_t const *clut,
+                           std::uint8_t *render_target,
+                           unsigned words_in_input) {
+  for (unsigned i = 0; i < words_in_input; ++i) {
+    std::uint32_t bits = input_line[i];
+    // Pixels are packed LSB first.
+    for (unsigned b = 0; b < 32; ++b) {
+      *render_target++ = clut[(bits >> b) & 1];
+    }
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_1bpp_impl(std::uint32_t const *input_line,
+                      std::uint8_t const *clut,
+                      std::uint8_t *render_target,
+                      unsigned words_in_input) {
+  unpack_1bpp_reference(input_line, clut, render_target, words_in_input);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,38 @@
+#include "vga/rast/unpack_1bpp.h"
+
+// C++ version of unpack_1bpp_overlay.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_1bpp_overlay_reference(std::uint32_t const *input_line,
+                                   std::uint8_t const *clut,
+                                   std::uint8_t *render_target,
+                                   unsigned words_in_input,
+                                   std::uint8_t const * background) {
+  // Only the one color is used; zero bits let the background through.
+  std::uint8_t one = clut[1];
+  for (unsigned i = 0; i < words_in_input; ++i) {
+    std::uint32_t bits = input_line[i];
+    for (unsigned b = 0; b < 32; ++b) {
+      std::uint8_t bg = *background++;
+      *render_target++ = (bits >> b) & 1 ? one : bg;
+    }
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_1bpp_overlay_impl(std::uint32_t const *input_line,
+                              std::uint8_t const *clut,
+                              std::uint8_t *render_target,
+                              unsigned words_in_input,
+                              std::uint8_t const * background) {
+  unpack_1bpp_overlay_reference(input_line, clut, render_target,
+                                words_in_input, background);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,39 @@
+#include "vga/rast/unpack_affine.h"
+
+// C++ version of unpack_affine.S.
+
+namespace vga {
+namespace rast {
+
+// Shifts right as the M4's register-specified LSR does: by 32 or more, the
+// result is zero rather than undefined.
+static std::uint32_t lsr(std::uint32_t x, std::uint32_t shift) {
+  return shift < 32 ? x >> shift : 0;
+}
+
+void unpack_affine_reference(std::uint8_t const *texture,
+                             std::uint8_t *render_target,
+                             unsigned words_out,
+                             AffineSpan const *span) {
+  std::uint32_t u = span->u, v = span->v;
+  for (unsigned i = 0; i < words_out * 4; ++i) {
+    *render_target++ = texture[lsr(u, span->u_shift)
+                               + (lsr(v, span->v_shift) & span->v_mask)];
+    u += span->du;
+    v += span->dv;
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_affine_impl(std::uint8_t const *texture,
+                        std::uint8_t *render_target,
+                        unsigned words_out,
+                        AffineSpan const *span) {
+  unpack_affine_reference(texture, render_target, words_out, span);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
@@ -0,0 +1,51 @@
+#ifndef VGA_RAST_UNPACK_AFFINE_H
+#define VGA_RAST_UNPACK_AFFINE_H
+
+#include <cstdint>
+
+namespace vga {
+namespace rast {
+
+/*
+ * Parameters for unpack_affine_impl: a walk through a texture of 2^a by 2^b
+ * pixels.  Texture coordinates are fixed-point, with their integer parts in
+ * the top bits, so that they wrap at the texture edges for free:
+ *
+ *  x = u >> u_shift                    (u_shift = 32 - a)
+ *  y * 2^a = (v >> v_shift) & v_mask   (v_shift = 32 - a - b,
+ *                                       v_mask = (2^b - 1) << a)
+ *
+ * A texture dimension of 1 gives a shift of 32, which yields zero, as the
+ * M4's LSR does; shifts must not exceed 32.
+ *
+ * After each pixel, du and dv are added to u and v.  Only the stepping
+ * registers change during the walk; this struct is not written.
+ */
+struct AffineSpan {
+  std::uint32_t u;
+  std::uint32_t v;
+  std::uint32_t du;
+  std::uint32_t dv;
+  std::uint32_t u_shift;
+  std::uint32_t v_shift;
+  std::uint32_t v_mask;
+};
+
+/*
+ * Samples words_out * 4 pixels from texture along the given span.
+ */
+void unpack_affine_impl(std::uint8_t const *texture,
+                        std::uint8_t *render_target,
+                        unsigned words_out,
+                        AffineSpan const *span);
+
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_affine_reference(std::uint8_t const *texture,
+                             std::uint8_t *render_target,
+                             unsigned words_out,
+                             AffineSpan const *span);
+
+}  // namespace rast
+}  // namespace vga
+
+#endif  // VGA_RAST_UNPACK_AFFINE_H
@@ -0,0 +1,36 @@
+#include "vga/rast/unpack_direct_rev.h"
+
+#include <cstdint>
+
+// C++ version of unpack_direct_rev.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_direct_rev_reference(void const *input_line,
+                                 unsigned char *render_target,
+                                 unsigned bytes_in_input) {
+  // input_line is the end of the line.  Like the assembly version, this works
+  // in whole words, so it may copy up to three bytes more than asked.
+  auto in = static_cast<std::uint8_t const *>(input_line);
+  for (unsigned i = 0; i < (bytes_in_input + 3) / 4; ++i) {
+    in -= 4;
+    *render_target++ = in[3];
+    *render_target++ = in[2];
+    *render_target++ = in[1];
+    *render_target++ = in[0];
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_direct_rev_impl(void const *input_line,
+                            unsigned char *render_target,
+                            unsigned bytes_in_input) {
+  unpack_direct_rev_reference(input_line, render_target, bytes_in_input);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
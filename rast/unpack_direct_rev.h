@@ -8,6 +8,11 @@ void unpack_direct_rev_impl(void const *input_line,
                             unsigned char *render_target,
                             unsigned bytes_in_input);
 
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_direct_rev_reference(void const *input_line,
+                                 unsigned char *render_target,
+                                 unsigned bytes_in_input);
+
 }  // namespace rast
 }  // namespace vga
 
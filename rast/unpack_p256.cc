@@ -0,0 +1,30 @@
+#include "vga/rast/unpack_p256.h"
+
+// C++ version of unpack_p256.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_p256_reference(void const *input_line,
+                           unsigned char *render_target,
+                           unsigned words_in_input,
+                           std::uint8_t const * palette) {
+  auto in = static_cast<std::uint8_t const *>(input_line);
+  for (unsigned i = 0; i < words_in_input * 4; ++i) {
+    render_target[i] = palette[in[i]];
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_p256_impl(void const *input_line,
+                      unsigned char *render_target,
+                      unsigned words_in_input,
+                      std::uint8_t const * palette) {
+  unpack_p256_reference(input_line, render_target, words_in_input, palette);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
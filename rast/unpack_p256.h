@@ -11,6 +11,12 @@ void unpack_p256_impl(void const *input_line,
                       unsigned words_in_input,
                       std::uint8_t const * palette);
 
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_p256_reference(void const *input_line,
+                           unsigned char *render_target,
+                           unsigned words_in_input,
+                           std::uint8_t const * palette);
+
 }  // namespace rast
 }  // namespace vga
 
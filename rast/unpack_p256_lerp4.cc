@@ -0,0 +1,39 @@
+#include "vga/rast/unpack_p256_lerp4.h"
+
+// C++ version of unpack_p256_lerp4.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_p256_lerp4_reference(void const *input_line,
+                                 unsigned char *render_target,
+                                 unsigned bytes_in_input,
+                                 std::uint8_t const * palette0) {
+  auto in = static_cast<std::uint8_t const *>(input_line);
+  // Each pair of neighboring inputs produces four outputs, so the last input
+  // is only used as the right end of the final interpolation.
+  for (unsigned i = 0; i + 1 < bytes_in_input; ++i) {
+    int left = in[i];
+    int delta = in[i + 1] - left;
+    // The assembly's SMMLAR rounds k/4 of the way from left to right like
+    // this -- toward positive infinity at the halfway points.
+    for (int k = 0; k < 4; ++k) {
+      *render_target++ = palette0[left + ((k * delta + 2) >> 2)];
+    }
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_p256_lerp4_impl(void const *input_line,
+                            unsigned char *render_target,
+                            unsigned bytes_in_input,
+                            std::uint8_t const * palette0) {
+  unpack_p256_lerp4_reference(input_line, render_target, bytes_in_input,
+                              palette0);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
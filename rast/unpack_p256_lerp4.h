@@ -11,6 +11,12 @@ void unpack_p256_lerp4_impl(void const *input_line,
                             unsigned bytes_in_input,
                             std::uint8_t const * palette0);
 
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_p256_lerp4_reference(void const *input_line,
+                                 unsigned char *render_target,
+                                 unsigned bytes_in_input,
+                                 std::uint8_t const * palette0);
+
 }  // namespace rast
 }  // namespace vga
 
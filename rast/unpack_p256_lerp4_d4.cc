@@ -0,0 +1,44 @@
+#include "vga/rast/unpack_p256_lerp4_d4.h"
+
+// C++ version of unpack_p256_lerp4_d4.S.
+
+namespace vga {
+namespace rast {
+
+void unpack_p256_lerp4_d4_reference(void const *input_line,
+                                    unsigned char *render_target,
+                                    unsigned bytes_in_input,
+                                    std::uint8_t const * palette0,
+                                    std::uint8_t const * palette1) {
+  auto in = static_cast<std::uint8_t const *>(input_line);
+  // As unpack_p256_lerp4, but each interpolated index produces four pixels,
+  // alternating between the two palettes.
+  for (unsigned i = 0; i + 1 < bytes_in_input; ++i) {
+    int left = in[i];
+    int delta = in[i + 1] - left;
+    for (int k = 0; k < 4; ++k) {
+      int index = left + ((k * delta + 2) >> 2);
+      std::uint8_t c0 = palette0[index], c1 = palette1[index];
+      *render_target++ = c0;
+      *render_target++ = c1;
+      *render_target++ = c0;
+      *render_target++ = c1;
+    }
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_p256_lerp4_d4_impl(void const *input_line,
+                               unsigned char *render_target,
+                               unsigned bytes_in_input,
+                               std::uint8_t const * palette0,
+                               std::uint8_t const * palette1) {
+  unpack_p256_lerp4_d4_reference(input_line, render_target, bytes_in_input,
+                                 palette0, palette1);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
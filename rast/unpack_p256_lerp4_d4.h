@@ -12,6 +12,13 @@ void unpack_p256_lerp4_d4_impl(void const *input_line,
                                std::uint8_t const * palette0,
                                std::uint8_t const * palette1);
 
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_p256_lerp4_d4_reference(void const *input_line,
+                                    unsigned char *render_target,
+                                    unsigned bytes_in_input,
+                                    std::uint8_t const * palette0,
+                                    std::uint8_t const * palette1);
+
 }  // namespace rast
 }  // namespace vga
 
@@ -0,0 +1,43 @@
+#include "vga/rast/unpack_text_10p_attributed.h"
+
+#include <cstdint>
+
+// C++ version of unpack_text_10p_attributed.S, which documents the formats.
+
+namespace vga {
+namespace rast {
+
+void unpack_text_10p_attributed_reference(void const *input_line,
+                                          unsigned char const *font,
+                                          unsigned char *render_target,
+                                          unsigned cols_in_input) {
+  auto text = static_cast<std::uint32_t const *>(input_line);
+  for (unsigned i = 0; i < cols_in_input; ++i) {
+    std::uint32_t c = text[i];
+    std::uint8_t back = c >> 8;
+    std::uint8_t fore = c >> 16;
+    std::uint8_t glyph = font[c & 0xFF];
+
+    // Eight pixels from the glyph, LSB first, then a two-pixel gutter.
+    for (unsigned b = 0; b < 8; ++b) {
+      *render_target++ = (glyph >> b) & 1 ? fore : back;
+    }
+    *render_target++ = back;
+    *render_target++ = back;
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void unpack_text_10p_attributed_impl(void const *input_line,
+                                     unsigned char const *font,
+                                     unsigned char *render_target,
+                                     unsigned cols_in_input) {
+  unpack_text_10p_attributed_reference(input_line, font, render_target,
+                                       cols_in_input);
+}
+
+#endif  // __ARM_PCS_VFP
+
+}  // namespace rast
+}  // namespace vga
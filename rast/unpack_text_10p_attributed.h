@@ -9,6 +9,12 @@ void unpack_text_10p_attributed_impl(void const *input_line,
                                      unsigned char *render_target,
                                      unsigned cols_in_input);
 
+// C++ equivalent, built everywhere; the assembly is checked against it.
+void unpack_text_10p_attributed_reference(void const *input_line,
+                                          unsigned char const *font,
+                                          unsigned char *render_target,
+                                          unsigned cols_in_input);
+
 }  // namespace rast
 }  // namespace vga
 
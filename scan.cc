@@ -0,0 +1,698 @@
+#include "vga/scan.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include "etl/algorithm.h"
+#include "etl/attribute_macros.h"
+#include "etl/prediction.h"
+
+#include "vga/copy_words.h"
+#include "vga/effect.h"
+#include "vga/profile.h"
+
+using std::size_t;
+
+using etl::armv7m::Byte;
+using etl::armv7m::HalfWord;
+using etl::armv7m::Word;
+
+#define IN_SCAN_RAM ETL_SECTION(".vga_scan_ram")
+#define IN_LOCAL_RAM ETL_SECTION(".vga_local_ram")
+
+#define RAM_CODE ETL_SECTION(".ramcode")
+
+namespace vga {
+namespace scan {
+
+/*******************************************************************************
+ * Driver state.
+ */
+
+Timing current_timing;
+
+unsigned volatile current_line;
+
+State volatile state;
+
+#ifndef VGA_ZERO_COPY_SCANOUT
+
+// This is the DMA source for scan-out, copied from the working buffers during
+// hblank.  It must be located in DMA-capable RAM, and is aligned to allow for
+// word-sized DMA reads.
+//
+// It contains an extra word's worth of pixels to ensure that we can follow
+// every line with an extra transfer to blank the outputs.  The extra pixels
+// are blanked after each copy.
+alignas(Word) IN_SCAN_RAM
+Pixel scan_buffer[max_pixels_per_line + sizeof(Word)];
+
+// These are the working buffers, the targets of the Rasterizer, arranged as a
+// ring: the lookahead queue.  Their contents are copied to the scan_buffer
+// during hblank as they're needed.  They need not be in DMA-capable RAM.
+//
+// They're aligned so we can use a high-speed word copy routine.
+//
+// Each has invisible padding at either end because it makes certain tile
+// scrolling algorithms simpler to implement if they need not color precisely
+// within the lines.
+alignas(Word) IN_LOCAL_RAM
+static struct {
+  Word left_pad[extra_pad_words];
+  Pixel buffer[max_pixels_per_line];
+  Word right_pad[extra_pad_words];
+} working[lookahead_lines];
+
+#else  // VGA_ZERO_COPY_SCANOUT
+
+// In zero-copy mode, the scan buffer is used only for blank and border lines,
+// which need at most one pixel plus the blanking word.
+alignas(Word) IN_SCAN_RAM
+Pixel scan_buffer[2 * sizeof(Word)];
+
+// The working buffers are scanned out directly, so they must be in DMA-capable
+// RAM and word aligned.  The right pad ensures that there is always room for
+// the blanking word after a full-width line.
+alignas(Word) IN_SCAN_RAM
+static struct {
+  Word left_pad[extra_pad_words];
+  Pixel buffer[max_pixels_per_line];
+  Word right_pad[extra_pad_words];
+} working[lookahead_lines];
+
+#endif  // VGA_ZERO_COPY_SCANOUT
+
+Pixel const *scan_source;
+
+// Describes the contents of the corresponding working buffer.
+struct QueuedLine {
+  // Shape as returned by the Rasterizer, with repeat_lines clamped so that
+  // the line doesn't extend past the end of its band.
+  Rasterizer::RasterInfo shape;
+  // First visible line covered.  The line covers repeat_lines more after it.
+  unsigned first_line;
+  // Band list position, for profiling and overrun handling.
+  unsigned band_index;
+  // Visible line just past the end of that band.
+  unsigned band_end;
+  // Value of frame_number when the line was rasterized.
+  unsigned frame;
+};
+
+IN_LOCAL_RAM
+static QueuedLine working_info[lookahead_lines];
+
+// Queue indices.  These count up forever (well, modulo 2^32, which is a
+// multiple of lookahead_lines) and are reduced to a ring position on use.
+// produced is written only by rasterize_ahead, consumed only at EAV.  Working
+// buffers from consumed up to produced are off limits to the rasterizer.
+static std::atomic<unsigned> produced, consumed;
+
+// Index of the next queued line that update_scan_buffer hasn't looked at.
+// This is the same as consumed, except in zero-copy mode, where consumed lags
+// by one to hold onto the working buffer being scanned out.
+static unsigned next_queued;
+
+// Incremented at the start of each frame.  Used to recognize, and discard,
+// lines rasterized for a previous frame.
+static unsigned volatile frame_number;
+
+Rasterizer::RasterInfo scan_buffer_shape;
+
+unsigned scan_band_index;
+
+// Visible line just past the end of the band at scan_band_index.
+static unsigned scan_band_end;
+
+// Visible line just past the last one covered by the scan buffer contents, and
+// the frame they belong to.  While the current line is short of this, the scan
+// buffer is simply repeated.
+static unsigned scan_line_end;
+static unsigned scan_frame;
+
+// Overrun handling.  See configure_overrun_policy.
+static OverrunPolicy overrun_policy;
+static Pixel overrun_border_color;
+static unsigned volatile overrun_count;
+
+// Set by update_scan_buffer, under OverrunPolicy::skip_band, to the index of
+// the band rasterize_ahead should give up on.
+static unsigned volatile skip_band_index;
+
+// The head of the linked list of Rasterizer bands.
+static Band const *band_list_head;
+
+// A band list compiled into a table by configure_compiled_band_list.
+struct BandSchedule {
+  unsigned count;
+  struct {
+    Rasterizer *rasterizer;
+    unsigned line_count;
+    Effect const *effects;
+    unsigned effect_count;
+  } bands[max_compiled_bands];
+};
+
+// Tables for configure_compiled_band_list.  There are three, so that the
+// application can always find one that's neither in use by the driver nor
+// about to be.
+IN_LOCAL_RAM
+static BandSchedule band_schedules[3];
+
+// The compiled table most recently configured, if any.  If set, this takes
+// precedence over band_list_head.
+static BandSchedule const * volatile pending_band_schedule;
+
+// The following describe the producer's position in the frame.  They're only
+// touched by rasterize_ahead.
+
+// The frame that rasterize_ahead is working on.
+static unsigned produced_frame;
+
+// Next visible line to rasterize.
+static unsigned raster_line;
+
+// The compiled table latched for this frame, or nullptr if we're walking a
+// linked list.
+static BandSchedule const *band_schedule;
+
+// When walking a linked list, the band after the current one.
+static Band const *next_list_band;
+
+// The band we're currently processing.  We copy what we need out of the Band
+// for several reasons:
+// - So that the application may keep its Bands in Flash without a latency
+//   penalty on the driver.
+// - So that we may count down its lines.
+// - So that the application may rewrite its Bands once rendering starts.
+static Rasterizer *current_rasterizer;
+
+// Lines remaining in the current band, including raster_line.
+static unsigned band_lines_left;
+
+// Total lines in the current band, so we can tell where raster_line falls
+// within it.
+static unsigned band_line_count;
+
+// The current band's effects that haven't yet been applied.
+static Effect const *next_effect;
+static unsigned effects_left;
+
+// Position of the current band within the band list.
+static unsigned current_band_index;
+
+// A semaphore used to indicate, to the application, when the driver has
+// begun processing the most recently configured band list.  Because the
+// driver maintains a copy of a Band, and this copy contains a pointer, it
+// is not safe to deallocate or repurpose a list of Bands while the driver
+// may be using them.  Instead, clear_band_list does it safely using this
+// semaphore.
+std::atomic<bool> band_list_taken{false};
+
+
+/*******************************************************************************
+ * Setup.
+ */
+
+void reset(Timing const &timing) {
+  // Scribble over working buffers to help catch bugs.
+  for (auto &w : working) {
+    for (size_t i = 0; i < sizeof(w.buffer); i += 2) {
+      w.buffer[i] = 0xFF;
+      w.buffer[i + 1] = 0x00;
+    }
+  }
+
+  // Start out scanning a blank line.
+  for (auto &p : scan_buffer) p = 0;
+  scan_source = scan_buffer;
+
+  // Set up global state.
+  current_line = 0;
+  current_timing = timing;
+  state = State::blank;
+  scan_buffer_shape = {
+    .offset = 0,
+    .length = 0,
+    .cycles_per_pixel = timing.cycles_per_pixel,
+    .repeat_lines = 0,
+  };
+  scan_band_index = 0;
+
+  // Empty the queue, and leave the producer idle until the next frame starts.
+  next_queued = produced;
+  consumed = next_queued;
+  frame_number = 0;
+  produced_frame = 0;
+  raster_line = timing.video_end_line - timing.video_start_line;
+  effects_left = 0;
+  scan_line_end = 0;
+  scan_frame = 0;
+  scan_band_end = 0;
+}
+
+
+/*******************************************************************************
+ * Vertical timing state machine.
+ */
+
+RAM_CODE
+bool end_of_line() {
+  // We've finished this line; figure out what to do on the next one.
+  unsigned next_line = current_line + 1;
+  bool vsync_edge = false;
+
+  if (next_line == current_timing.vsync_start_line
+      || next_line == current_timing.vsync_end_line) {
+    // Either edge of vsync pulse.
+    vsync_edge = true;
+  } else if (next_line == uint16_t(current_timing.video_start_line - 1)) {
+    // We're one line before scanout begins -- need to start rasterizing.
+    // rasterize_ahead will notice the new frame number and latch the band
+    // list.  Anything still queued belongs to the previous frame; drop it.
+    state = State::starting;
+    ++frame_number;
+    next_queued = produced;
+    consumed = next_queued;
+#ifdef VGA_ZERO_COPY_SCANOUT
+    // That includes the working buffer we were scanning out, so switch to a
+    // blank line until we have something better.
+    scan_source = scan_buffer;
+    scan_buffer[0] = 0;
+    scan_buffer_shape.offset = 0;
+    scan_buffer_shape.length = 0;
+    scan_buffer_shape.cycles_per_pixel = current_timing.cycles_per_pixel;
+#endif
+  } else if (next_line == current_timing.video_start_line) {
+    // Time to start output.  This will cause EAV to copy rasterization
+    // output into place for scanout, and the next SAV will start DMA.
+    state = State::active;
+  } else if (next_line == uint16_t(current_timing.video_end_line - 1)) {
+    // For the final line, suppress rasterization but continue preparing
+    // previously rasterized data for scanout, and continue starting DMA in
+    // SAV.
+    state = State::finishing;
+  } else if (next_line == uint16_t(current_timing.video_end_line)) {
+    // All done!  Suppress all scanout activity.
+    state = State::blank;
+    next_line = 0;
+  }
+
+  current_line = next_line;
+  return vsync_edge;
+}
+
+
+/*******************************************************************************
+ * Rasterization.
+ */
+
+RAM_CODE
+void update_scan_buffer() {
+  unsigned line = current_line - current_timing.video_start_line;
+  unsigned frame = frame_number;
+
+  // If the scan buffer's contents cover this line, there's nothing to do.
+  // This is the common case for line-doubling rasterizers.
+  if (scan_frame == frame && line < scan_line_end) return;
+
+  // Otherwise, look for the line in the queue.  Lines rasterized for an
+  // earlier frame are discarded.  If the rasterizer has fallen behind, we may
+  // find lines that scanout has already passed; we skip over them, but keep
+  // the most recent in case nothing better turns up.
+  unsigned c = next_queued;
+  unsigned pick = c;
+  bool found = false;
+  while (c != produced) {
+    auto const &info = working_info[c % lookahead_lines];
+    if (info.frame != frame) {
+      ++c;
+      continue;
+    }
+
+    // Lines are queued in order, so if this one isn't due yet, nothing after
+    // it is either.
+    if (info.first_line > line) break;
+
+    pick = c++;
+    found = true;
+    if (line <= info.first_line + info.shape.repeat_lines) break;
+  }
+  next_queued = c;
+
+  if (found) {
+    auto const &info = working_info[pick % lookahead_lines];
+    auto &w = working[pick % lookahead_lines];
+
+#ifndef VGA_ZERO_COPY_SCANOUT
+    // Note that GCC can't see that we've aligned the buffers correctly, so we
+    // have to do a multi-cast dance. :-/
+    copy_words(
+        reinterpret_cast<Word const *>(
+          static_cast<void *>(w.buffer)),
+        reinterpret_cast<Word *>(
+          static_cast<void *>(scan_buffer)),
+        (info.shape.length + sizeof(Word) - 1) / sizeof(Word));
+    for (unsigned i = 0; i < sizeof(Word); ++i) {
+      scan_buffer[info.shape.length + i] = 0;
+    }
+    // Release the working buffer (and any we skipped) for reuse.
+    consumed = c;
+#else
+    // Scan out of the working buffer in place.  The rasterizer blanked the
+    // word after the line for us.  Release any working buffers before this
+    // one -- including the one scanned out last line -- but hang onto this
+    // one until we're done with it.
+    scan_source = w.buffer;
+    consumed = pick;
+#endif
+
+    scan_buffer_shape = info.shape;
+    scan_band_index = info.band_index;
+    scan_band_end = info.band_end;
+    scan_line_end = info.first_line + info.shape.repeat_lines + 1;
+    scan_frame = frame;
+
+    if (line < scan_line_end) return;
+  } else {
+#ifndef VGA_ZERO_COPY_SCANOUT
+    consumed = c;
+#else
+    // We're still scanning out of the working buffer at consumed, if any, so
+    // we can't release anything.
+#endif
+  }
+
+  // The line isn't ready: the rasterizer has fallen behind by more than the
+  // depth of the queue.  We're left repeating an earlier line, unless policy
+  // says otherwise.
+  //
+  // We blame the band the missed line belongs to.  If that's the band of the
+  // last line we took from the queue, we know it; otherwise we haven't seen
+  // any of the line's band yet, so the rasterizer is still working toward it,
+  // and it's the band the rasterizer is in.  (The rasterizer's band alone
+  // won't do: once it has given up on a band and moved on, the rest of the
+  // abandoned band's lines would be charged to the next.)
+  unsigned band = scan_frame == frame && line < scan_band_end
+                ? scan_band_index
+                : current_band_index;
+  ++overrun_count;
+  profile_record_deadline_miss(band);
+
+  switch (overrun_policy) {
+    case OverrunPolicy::repeat_line:
+      break;
+
+    case OverrunPolicy::border:
+      // Stretch a single pixel across the line, like SolidColor.
+      scan_buffer[0] = overrun_border_color;
+      for (unsigned i = 1; i <= sizeof(Word); ++i) scan_buffer[i] = 0;
+      scan_source = scan_buffer;
+      scan_buffer_shape = {
+        .offset = 0,
+        .length = 1,
+        .cycles_per_pixel = unsigned(current_timing.video_pixels)
+                          * current_timing.cycles_per_pixel,
+        .repeat_lines = 0,
+      };
+#ifdef VGA_ZERO_COPY_SCANOUT
+      // No longer scanning out of a working buffer.
+      consumed = next_queued;
+#endif
+      break;
+
+    case OverrunPolicy::skip_band:
+      // If the rasterizer has already left this band, this has no effect.
+      skip_band_index = band;
+      break;
+  }
+}
+
+RAM_CODE
+ScanoutPlan plan_scanout() {
+  auto length = scan_buffer_shape.length;
+  auto cycles_per_pixel = scan_buffer_shape.cycles_per_pixel;
+
+  // The number of bytes read must exactly match the number of bytes written,
+  // or the DMA controller will freak out.  Thus, we must adapt the transfer
+  // size to the number of bytes transferred.
+  unsigned transfer_bytes;
+  switch (length & 3) {
+    case 0:  transfer_bytes = sizeof(Word); break;
+    case 2:  transfer_bytes = sizeof(HalfWord); break;
+    default: transfer_bytes = sizeof(Byte); break;
+  }
+
+  if (cycles_per_pixel > 4) {
+    // Timer-paced: NDTR counts bytes written to the GPIO.
+    return {
+      .use_timer = true,
+      .transfer_bytes = transfer_bytes,
+      .transfer_count = length + transfer_bytes,
+      .cycles_per_pixel = cycles_per_pixel,
+    };
+  } else {
+    // Memory-to-memory: NDTR counts reads from the scan buffer.
+    return {
+      .use_timer = false,
+      .transfer_bytes = transfer_bytes,
+      .transfer_count = length / transfer_bytes + 1,
+      .cycles_per_pixel = cycles_per_pixel,
+    };
+  }
+}
+
+/*
+ * Applies the current band's effects for lines up to and including band_line.
+ */
+RAM_CODE
+static void apply_effects(unsigned band_line) {
+  while (effects_left && next_effect->line <= band_line) {
+    next_effect->apply(next_effect->object, next_effect->value);
+    ++next_effect;
+    --effects_left;
+  }
+}
+
+/*
+ * Moves the producer into the next band, if there is one.  Returns false at
+ * the end of the band list.
+ */
+RAM_CODE
+static bool next_band() {
+  // Whatever happened to the band we're leaving, its effects take hold.
+  apply_effects(-1U);
+
+  if (band_schedule) {
+    // Compiled table: a simple indexed load.
+    if (current_band_index + 1 >= band_schedule->count) return false;
+    auto const &b = band_schedule->bands[++current_band_index];
+    current_rasterizer = b.rasterizer;
+    band_lines_left = b.line_count;
+    next_effect = b.effects;
+    effects_left = b.effect_count;
+  } else {
+    if (!next_list_band) return false;
+    auto const &b = *next_list_band;
+    current_rasterizer = b.rasterizer;
+    band_lines_left = b.line_count;
+    next_effect = b.effects;
+    effects_left = b.effect_count;
+    next_list_band = b.next;
+    ++current_band_index;
+  }
+  band_line_count = band_lines_left;
+  return true;
+}
+
+/*
+ * Latches the band list for a new frame.
+ */
+RAM_CODE
+static void start_frame() {
+  produced_frame = frame_number;
+  raster_line = 0;
+
+  band_schedule = pending_band_schedule;
+  next_list_band = band_schedule ? nullptr : band_list_head;
+  current_rasterizer = nullptr;
+  band_lines_left = 0;
+  // next_band pre-increments, so start one before the first band.  (This
+  // wraps, which is fine, as it's unsigned.)
+  current_band_index = -1U;
+  if (!next_band()) current_band_index = 0;
+  skip_band_index = -1U;
+
+  band_list_taken = true;
+}
+
+/*
+ * Moves the producer forward by the given number of lines, crossing into later
+ * bands as required.
+ */
+RAM_CODE
+static void advance_lines(unsigned count) {
+  raster_line += count;
+  while (count) {
+    if (band_lines_left == 0 && !next_band()) {
+      return;  // Past the end of the list.
+    }
+
+    auto n = etl::min(count, band_lines_left);
+    band_lines_left -= n;
+    count -= n;
+  }
+}
+
+RAM_CODE
+void rasterize_ahead() {
+  auto const &timing = current_timing;
+  unsigned const visible_lines =
+      timing.video_end_line - timing.video_start_line;
+
+  while (true) {
+    if (produced_frame != frame_number) start_frame();
+
+    // If scanout has given up on this band, so do we.
+    if (skip_band_index == current_band_index) {
+      advance_lines(band_lines_left);
+    }
+
+    // If scanout has overtaken us, don't bother with lines it has passed.
+    if (state == State::active || state == State::finishing) {
+      unsigned needed = current_line - timing.video_start_line + 1;
+      if (raster_line < needed) advance_lines(needed - raster_line);
+    }
+
+    if (raster_line >= visible_lines) return;  // Frame complete.
+    unsigned p = produced;
+    if (p - consumed >= lookahead_lines) return;  // Queue full.
+
+    // Find the band containing raster_line.
+    while (band_lines_left == 0 && next_band()) continue;
+
+    // Lines from here to the end of the band, or of the frame if we've run
+    // off the end of the band list.
+    unsigned lines_left = band_lines_left ? band_lines_left
+                                          : visible_lines - raster_line;
+
+    // Bring rasterizer state up to date for this line.
+    unsigned band_line = band_line_count - band_lines_left;
+    apply_effects(band_line);
+
+    auto &info = working_info[p % lookahead_lines];
+    auto r = band_lines_left ? current_rasterizer : nullptr;
+    if (r) {
+      auto start = profile_clock();
+      info.shape = r->rasterize(timing.cycles_per_pixel,
+                                raster_line,
+                                working[p % lookahead_lines].buffer);
+      profile_record_rasterize(current_band_index, r, start);
+    } else {
+      // No rasterizer: output black until the band (or frame) ends.
+      info.shape = {
+        .offset = 0,
+        .length = 0,
+        .cycles_per_pixel = timing.cycles_per_pixel,
+        .repeat_lines = lines_left - 1,
+      };
+    }
+
+    // A band edge ends the line's repeats, regardless of what the rasterizer
+    // wished.
+    if (info.shape.repeat_lines >= lines_left) {
+      info.shape.repeat_lines = lines_left - 1;
+    }
+    // Nor may it repeat into a line with effects, which must be rasterized
+    // afresh.
+    if (effects_left) {
+      unsigned until = next_effect->line - band_line;
+      if (info.shape.repeat_lines >= until) {
+        info.shape.repeat_lines = until - 1;
+      }
+    }
+#ifdef VGA_ZERO_COPY_SCANOUT
+    // This buffer will be scanned out directly, so it must end in a blank
+    // word.
+    for (unsigned i = 0; i < sizeof(Word); ++i) {
+      working[p % lookahead_lines].buffer[info.shape.length + i] = 0;
+    }
+#endif
+    info.first_line = raster_line;
+    info.band_index = current_band_index;
+    info.band_end = raster_line + lines_left;
+    info.frame = produced_frame;
+
+    // Publish the line.  If a new frame started while we were rasterizing,
+    // the consumer will recognize it as stale and toss it.
+    produced = p + 1;
+
+    advance_lines(info.shape.repeat_lines + 1);
+  }
+}
+
+}  // namespace scan
+
+
+/*******************************************************************************
+ * Hardware-independent parts of the driver API.
+ */
+
+void configure_band_list(Band const *head) {
+  scan::pending_band_schedule = nullptr;
+  scan::band_list_head = head;
+  scan::band_list_taken = false;
+}
+
+bool configure_compiled_band_list(Band const *head) {
+  // Find a table that the driver isn't using and won't latch before we're
+  // done.  The driver only ever latches the pending table, which we control,
+  // so if the latched table changes while we look, it changes to the pending
+  // one -- leaving our choice safe.
+  auto pending = scan::pending_band_schedule;
+  auto latched = scan::band_schedule;
+  scan::BandSchedule *table = scan::band_schedules;
+  while (table == pending || table == latched) ++table;
+
+  unsigned count = 0;
+  for (auto b = head; b; b = b->next) {
+    if (count == scan::max_compiled_bands) return false;
+    table->bands[count].rasterizer = b->rasterizer;
+    table->bands[count].line_count = b->line_count;
+    table->bands[count].effects = b->effects;
+    table->bands[count].effect_count = b->effect_count;
+    ++count;
+  }
+  table->count = count;
+
+  scan::band_list_head = nullptr;
+  scan::pending_band_schedule = table;
+  scan::band_list_taken = false;
+  return true;
+}
+
+void configure_overrun_policy(OverrunPolicy policy, Pixel border_color) {
+  scan::overrun_border_color = border_color;
+  scan::overrun_policy = policy;
+}
+
+unsigned get_overrun_count() {
+  return scan::overrun_count;
+}
+
+bool in_vblank() {
+  return scan::current_line < scan::current_timing.video_start_line;
+}
+
+void default_hblank_interrupt();  // decl hack
+RAM_CODE void default_hblank_interrupt() {}
+
+}  // namespace vga
+
+
+/*******************************************************************************
+ * User interrupt hook
+ */
+
+void vga_hblank_interrupt()
+  __attribute__((weak, alias("_ZN3vga24default_hblank_interruptEv")));
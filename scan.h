@@ -0,0 +1,179 @@
+#ifndef VGA_SCAN_H
+#define VGA_SCAN_H
+
+#include <atomic>
+#include <cstdint>
+
+#include "etl/armv7m/types.h"
+
+#include "vga/rasterizer.h"
+#include "vga/timing.h"
+#include "vga/vga.h"
+
+/*
+ * The hardware-independent half of the driver: the vertical line state
+ * machine, band list traversal, rasterization, and scan buffer management.
+ *
+ * Rasterization and scanout are decoupled by a small queue of rasterized
+ * lines.  The producer (rasterize_ahead) runs at the lowest interrupt priority
+ * and fills the queue whenever it has room; the consumer (update_scan_buffer
+ * and plan_scanout) runs at end of active video, preempting the producer if
+ * necessary.  This lets an expensive line borrow time from cheap ones, so a
+ * rasterizer need only keep up on average -- within the depth of the queue --
+ * rather than on every single line.
+ *
+ * By default, each line is copied from its working buffer into a dedicated
+ * scan buffer during hblank, so that rasterizers can work in fast local RAM
+ * that the DMA controller can't reach.  If the build environment defines
+ * VGA_ZERO_COPY_SCANOUT, the working buffers are instead placed in DMA-capable
+ * RAM and scanned out in place.  This removes the copy from hblank, leaving
+ * more of it for vga_hblank_interrupt, at two costs: one working buffer is
+ * always tied up by scanout, reducing the lookahead by a line; and
+ * rasterizers write to the same RAM that scanout is reading, so they contend
+ * with DMA for it during active video.
+ *
+ * On the target, the ISRs in vga.cc call into this and apply the results to
+ * the timers and DMA controller.  On a host, the simulator in sim/ calls into
+ * the same code and applies the results to models of those peripherals.
+ *
+ * This is an internal interface; applications should stick to vga.h.
+ */
+
+namespace vga {
+namespace scan {
+
+/*******************************************************************************
+ * Configuration.
+ */
+
+static constexpr unsigned
+  // Used to adjust size of scan and working buffers.
+  max_pixels_per_line = 848,
+  // Amount of pad to place on either side of each working buffer, so that lazy
+  // rasterizers can scribble slightly outside the lines -- in words.
+  extra_pad_words = 4,
+  // Number of rasterized lines that can be queued ahead of scanout.  Each
+  // costs a working buffer in local RAM.  Must be a power of two.
+  lookahead_lines = 4,
+  // Maximum number of Bands accepted by configure_compiled_band_list.
+  max_compiled_bands = 16;
+
+static_assert((lookahead_lines & (lookahead_lines - 1)) == 0,
+              "lookahead_lines must be a power of two");
+
+
+/*******************************************************************************
+ * State.
+ */
+
+/*
+ * The vertical timing state.  This is a Gray code and the bits have meaning.
+ * See the inspector functions below.
+ */
+enum class State {
+  blank     = 0b00,
+  starting  = 0b01,
+  active    = 0b11,
+  finishing = 0b10,
+};
+
+// Should we be producing a video signal?
+inline bool is_displayed_state(State s) {
+  return static_cast<unsigned>(s) & 0b10;
+}
+
+// Should we be rendering a scanline?
+inline bool is_rendered_state(State s) {
+  return static_cast<unsigned>(s) & 0b01;
+}
+
+// A copy of the current Timing, held in RAM for fast access.
+extern Timing current_timing;
+
+// [0, current_timing.video_end_line).  Updated at end of active video.
+extern unsigned volatile current_line;
+
+// The vertical timing state machine's current state.
+extern State volatile state;
+
+// The DMA source for scan-out of the current line, always followed by a
+// blanking word.  This is the scan buffer unless VGA_ZERO_COPY_SCANOUT is
+// defined.  Updated by update_scan_buffer.
+extern Pixel const *scan_source;
+
+// A description of the contents of the scan buffer, as produced by the
+// Rasterizer that generated it.  This is used to adjust the output timings.
+extern Rasterizer::RasterInfo scan_buffer_shape;
+
+// Position, within the band list, of the band that produced the scan buffer
+// contents.  Used to attribute profiling results.
+extern unsigned scan_band_index;
+
+// Set when the driver has begun processing the most recently configured band
+// list.  See clear_band_list.
+extern std::atomic<bool> band_list_taken;
+
+
+/*******************************************************************************
+ * Operations.
+ */
+
+/*
+ * Resets all scan state for the given timing.  Called by configure_timing with
+ * the horizontal timers stopped.
+ */
+void reset(Timing const &);
+
+/*
+ * Advances the line state machine at end of active video.  Returns true if the
+ * vertical sync output should be toggled at this point.
+ */
+bool end_of_line();
+
+/*
+ * Brings the scan buffer up to date for the current line, taking the next
+ * rasterized line from the queue if the one in the scan buffer has run out of
+ * repeats.  Call only in displayed states.
+ *
+ * If the line isn't ready, the scan buffer is left alone, so the previous line
+ * is displayed again.
+ */
+void update_scan_buffer();
+
+/*
+ * Scanout parameters for the line in the scan buffer, expressed in the units
+ * the DMA controller wants.  Computed by plan_scanout during hblank and applied
+ * to the hardware (or the hardware model).
+ */
+struct ScanoutPlan {
+  // If true, transfers are paced by TIM1 at cycles_per_pixel, and the scan
+  // buffer is the memory side of a memory-to-peripheral transfer.  If false,
+  // the DMA controller runs flat-out memory-to-memory (4 cycles per pixel) and
+  // the scan buffer is the *peripheral* side.
+  bool use_timer;
+
+  // Size, in bytes, of each transfer on the scan buffer side: 1, 2, or 4.
+  unsigned transfer_bytes;
+
+  // Value for the stream's NDTR register, which counts peripheral-side
+  // transfers: single bytes in timer mode, transfer_bytes otherwise.  This
+  // includes the trailing transfer that blanks the outputs.
+  unsigned transfer_count;
+
+  // AHB cycles per pixel, as requested by the rasterizer.
+  unsigned cycles_per_pixel;
+};
+
+ScanoutPlan plan_scanout();
+
+/*
+ * Rasterizes lines of the current frame into the queue until it is full or
+ * the frame is complete.  This is safe to call on every line; it returns
+ * quickly if there's nothing to do.
+ */
+void rasterize_ahead();
+
+}  // namespace scan
+}  // namespace vga
+
+#endif  // VGA_SCAN_H
@@ -0,0 +1,28 @@
+#include "vga/shift_words.h"
+
+// C++ version of shift_words.S.
+
+using etl::armv7m::Word;
+
+void shift_words_reference(Word const *source,
+                           Word *dest,
+                           Word count,
+                           Word shift) {
+  Word carry = *source++;
+  while (count--) {
+    Word next = *source++;
+    *dest++ = (carry >> shift) | (next << (32 - shift));
+    carry = next;
+  }
+}
+
+#ifndef __ARM_PCS_VFP
+
+void shift_words(Word const *source,
+                 Word *dest,
+                 Word count,
+                 Word shift) {
+  shift_words_reference(source, dest, count, shift);
+}
+
+#endif  // __ARM_PCS_VFP
@@ -0,0 +1,32 @@
+#ifndef SHIFT_WORDS_H
+#define SHIFT_WORDS_H
+
+#include "etl/armv7m/types.h"
+
+/*
+ * Produces count words, each funnel-shifted out of two adjacent source words:
+ *
+ *   dest[i] = (source[i] >> shift) | (source[i + 1] << (32 - shift))
+ *
+ * This reads count + 1 source words.  shift must be in [1, 31]; for zero,
+ * use copy_words.
+ *
+ * This is the inner loop of an unaligned bitblt.  Both the source-unaligned
+ * and dest-unaligned cases reduce to it, once the first partial destination
+ * word has been written.
+ */
+void shift_words(etl::armv7m::Word const *source,
+                 etl::armv7m::Word *dest,
+                 etl::armv7m::Word count,
+                 etl::armv7m::Word shift);
+
+/*
+ * Portable implementation of shift_words, available on every architecture so
+ * that the assembly version can be checked and benchmarked against it.
+ */
+void shift_words_reference(etl::armv7m::Word const *source,
+                           etl::armv7m::Word *dest,
+                           etl::armv7m::Word count,
+                           etl::armv7m::Word shift);
+
+#endif  // SHIFT_WORDS_H
@@ -0,0 +1,227 @@
+#include "vga/sim/sim.h"
+
+#include <chrono>
+
+using std::uint8_t;
+
+/*
+ * The driver's arena lives in regions defined by the target's linker script.
+ * On the host we provide stand-ins of the same size as the STM32F407's CCM and
+ * SRAM112 banks.
+ */
+asm(R"(
+  .pushsection .bss
+  .balign 16
+  .global _ccm_arena_start
+  .global _ccm_arena_end
+_ccm_arena_start:
+  .skip 64 * 1024
+_ccm_arena_end:
+  .balign 16
+  .global _sram112_arena_start
+  .global _sram112_arena_end
+_sram112_arena_start:
+  .skip 112 * 1024
+_sram112_arena_end:
+  .popsection
+)");
+
+namespace vga {
+namespace sim {
+
+Simulator::Simulator(Timing const &timing)
+  : _width(timing.video_pixels),
+    _height(timing.video_end_line - timing.video_start_line),
+    _frame(_width * _height),
+    _lines(),
+    _port(0),
+    _stall_first(0),
+    _stall_count(0) {
+  scan::reset(timing);
+}
+
+void Simulator::stall_producer(unsigned first_line, unsigned count) {
+  _stall_first = first_line;
+  _stall_count = count;
+}
+
+void Simulator::run_frame() {
+  _lines.clear();
+  for (auto &p : _frame) p = 0;
+
+  do {
+    _lines.push_back(LineRecord());
+    step(_lines.back());
+  } while (scan::current_line != 0);
+}
+
+/*
+ * Simulates the events of one line in the order the hardware would produce
+ * them: end of active video on the previous line (TIM4 CC3), the hblank hook
+ * interrupt and PendSV that it pends, in priority order, and start of active
+ * video (TIM4 CC2).
+ *
+ * The simulator runs each ISR to completion, so rasterize_ahead is never
+ * preempted and the queue only underflows if the producer is stalled.
+ */
+void Simulator::step(LineRecord &rec) {
+  auto const &t = scan::current_timing;
+
+  // EAV: the line state machine advances, and if the new line is visible,
+  // the scan buffer is brought up to date and scanout is planned.  TIM4 CCR2
+  // is then loaded from the scan buffer's requested offset.
+  rec.vsync_edge = scan::end_of_line();
+  rec.line = scan::current_line;
+  rec.state = scan::state;
+  rec.plan = {};
+  rec.dma_bytes = 0;
+  rec.pixel_hash = 0;
+  rec.rasterize_ns = 0;
+
+  bool displayed = scan::is_displayed_state(scan::state);
+  if (displayed) {
+    scan::update_scan_buffer();
+    rec.plan = scan::plan_scanout();
+  }
+  rec.shape = scan::scan_buffer_shape;
+  rec.sav_pixel = t.sync_pixels + t.back_porch_pixels - t.video_lead
+                + scan::scan_buffer_shape.offset;
+
+  // The hblank hook's interrupt.
+  vga_hblank_interrupt();
+
+  // PendSV, unless the producer is stalled.
+  bool stalled = rec.line - t.video_start_line - _stall_first < _stall_count;
+  if (scan::is_rendered_state(scan::state) && !stalled) {
+    auto start = std::chrono::steady_clock::now();
+    scan::rasterize_ahead();
+    auto end = std::chrono::steady_clock::now();
+    rec.rasterize_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        end - start).count();
+  }
+
+  // SAV.
+  if (displayed) scan_out(rec);
+}
+
+/*
+ * Models the DMA stream and video port for one line.
+ *
+ * The DMA stream emits one byte per cycles_per_pixel AHB cycles, starting at
+ * the rasterizer's requested offset.  (The driver's video_lead compensates for
+ * DMA startup latency, so we treat the first byte as landing exactly on the
+ * offset.)  The port holds its last value whenever the stream isn't writing,
+ * so a line whose trailing transfer isn't blank will smear -- just as it
+ * would on a monitor.
+ */
+void Simulator::scan_out(LineRecord &rec) {
+  auto const &t = scan::current_timing;
+  auto const &plan = rec.plan;
+
+  unsigned bytes = plan.use_timer ? plan.transfer_count
+                                  : plan.transfer_count * plan.transfer_bytes;
+  unsigned const max_bytes = scan::max_pixels_per_line
+                           + sizeof(etl::armv7m::Word);
+  if (bytes > max_bytes) bytes = max_bytes;
+  rec.dma_bytes = bytes;
+
+  unsigned dma_cycles_per_pixel = plan.use_timer ? plan.cycles_per_pixel : 4;
+  unsigned cycles_per_pixel = t.cycles_per_pixel;
+
+  Pixel *row = &_frame[(rec.line - t.video_start_line) * _width];
+  Pixel before = _port;
+
+  for (unsigned x = 0; x < _width; ++x) {
+    // Time from the nominal start of this line's DMA to the center of the
+    // display pixel, in AHB cycles.
+    long c = long(x * cycles_per_pixel + cycles_per_pixel / 2)
+           - long(rec.shape.offset) * long(cycles_per_pixel);
+    if (c < 0) {
+      row[x] = before;
+    } else {
+      unsigned i = c / dma_cycles_per_pixel;
+      if (i < bytes) {
+        row[x] = scan::scan_source[i];
+      } else {
+        row[x] = bytes ? scan::scan_source[bytes - 1] : before;
+      }
+    }
+  }
+
+  if (bytes) _port = scan::scan_source[bytes - 1];
+
+  std::uint32_t hash = 2166136261u;
+  for (unsigned x = 0; x < _width; ++x) hash = (hash ^ row[x]) * 16777619u;
+  rec.pixel_hash = hash;
+}
+
+bool Simulator::write_ppm(char const *path, Rgb const *palette) const {
+  if (!palette) palette = default_palette();
+
+  std::FILE *f = std::fopen(path, "wb");
+  if (!f) return false;
+
+  std::fprintf(f, "P6\n%u %u\n255\n", _width, _height);
+  for (auto p : _frame) {
+    Rgb const &c = palette[p];
+    uint8_t rgb[3] = { c.r, c.g, c.b };
+    std::fwrite(rgb, 1, sizeof(rgb), f);
+  }
+
+  return std::fclose(f) == 0;
+}
+
+static char const *state_name(scan::State s) {
+  switch (s) {
+    case scan::State::blank:     return "blank";
+    case scan::State::starting:  return "starting";
+    case scan::State::active:    return "active";
+    case scan::State::finishing: return "finishing";
+  }
+  return "?";
+}
+
+void Simulator::write_log(std::FILE *f, bool host_time) const {
+  std::fprintf(f, "# line state sav offset length cpp repeat "
+                  "mode xfer_bytes ndtr dma_bytes vsync hash%s\n",
+               host_time ? " raster_ns" : "");
+  for (auto const &r : _lines) {
+    std::fprintf(f, "%u %s %u %d %u %u %u %s %u %u %u %d %08x",
+                 r.line,
+                 state_name(r.state),
+                 r.sav_pixel,
+                 r.shape.offset,
+                 r.shape.length,
+                 r.shape.cycles_per_pixel,
+                 r.shape.repeat_lines,
+                 r.plan.use_timer ? "timer" : "m2m",
+                 r.plan.transfer_bytes,
+                 r.plan.transfer_count,
+                 r.dma_bytes,
+                 r.vsync_edge,
+                 unsigned(r.pixel_hash));
+    if (host_time) std::fprintf(f, " %lu", r.rasterize_ns);
+    std::fputc('\n', f);
+  }
+}
+
+Rgb const *Simulator::default_palette() {
+  static Rgb palette[256];
+  static bool initialized = false;
+
+  if (!initialized) {
+    for (unsigned i = 0; i < 256; ++i) {
+      palette[i] = {
+        uint8_t(((i >> 0) & 3) * 85),
+        uint8_t(((i >> 2) & 3) * 85),
+        uint8_t(((i >> 4) & 3) * 85),
+      };
+    }
+    initialized = true;
+  }
+
+  return palette;
+}
+
+}  // namespace sim
+}  // namespace vga
@@ -0,0 +1,159 @@
+#ifndef VGA_SIM_SIM_H
+#define VGA_SIM_SIM_H
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "vga/rasterizer.h"
+#include "vga/scan.h"
+#include "vga/timing.h"
+#include "vga/vga.h"
+
+/*
+ * Host-side scanout simulator.
+ *
+ * This runs the driver's real line state machine, band traversal,
+ * rasterization and scan buffer management (scan.cc) on a host machine, in
+ * place of the ISRs in vga.cc.  The horizontal timers and the scanout DMA
+ * stream are replaced by a model that consumes the same ScanoutPlan the
+ * hardware driver would load into DMA2 and TIM1, and deposits the resulting
+ * pixels into a frame image.
+ *
+ * A simulator build (like the sim target in BUILD) links this file and
+ * scan.cc in place of vga.cc and measurement.cc, plus copy_words.cc,
+ * arena.cc, timing.cc, and whichever rasterizers the application uses, along
+ * with the portable versions of their unpackers (rast/unpack_*.cc).
+ * test/sim_frame.cc shows how to drive it.
+ *
+ * The driver state is global, so only one Simulator should exist at a time.
+ *
+ * Limits of the timing model:
+ * - Each ISR runs to completion in a fixed order (EAV, hblank hook, PendSV,
+ *   SAV).  Nothing is preempted, and nothing takes any modeled time, so a
+ *   rasterizer that would overrun its hblank on hardware -- or a queue that
+ *   would underflow -- still produces a perfect frame here.  To exercise the
+ *   driver's overrun handling, stall the producer explicitly with
+ *   stall_producer.
+ * - The DMA model is a fixed rate of one byte per cycles_per_pixel AHB cycles
+ *   with no startup latency, bus contention, or FIFO behavior.  Only the
+ *   TIM4/DMA2 plan is modeled; TIM1 and the sync outputs are not.
+ * - rasterize_ns in the line log is host wall-clock time, not target cycles.
+ *   It's useful to compare rasterizers with each other on the same host, and
+ *   nothing else.  Use tool/check_budget or the profiler (profile.h) for
+ *   target budgets.
+ */
+
+namespace vga {
+namespace sim {
+
+/*
+ * An output color, as written to a PPM image.
+ */
+struct Rgb {
+  std::uint8_t r, g, b;
+};
+
+/*
+ * Everything the simulator observed about one scanline.
+ */
+struct LineRecord {
+  // Line number within the frame, in [0, video_end_line).
+  unsigned line;
+  // Driver state during this line.
+  scan::State state;
+  // Pixel count at which start-of-active-video fired (TIM4 CCR2).
+  unsigned sav_pixel;
+  // Shape of the scan buffer contents, as of hblank.
+  Rasterizer::RasterInfo shape;
+  // DMA configuration used for this line.  Only meaningful if displayed.
+  scan::ScanoutPlan plan;
+  // Bytes delivered to the video port by the modeled DMA stream, including
+  // the trailing blanking transfer.
+  unsigned dma_bytes;
+  // Whether the vsync output toggled at the start of this line.
+  bool vsync_edge;
+  // FNV-1a hash of the line's pixels in the frame image.  Zero if not
+  // displayed.
+  std::uint32_t pixel_hash;
+  // Host wall-clock time spent in rasterize_ahead during this line's hblank,
+  // in nanoseconds.  Zero if no rasterization was done.  Not deterministic;
+  // see the notes on the timing model above.
+  unsigned long rasterize_ns;
+};
+
+class Simulator {
+public:
+  /*
+   * Resets the driver for the given timing, as configure_timing would.  The
+   * band list is configured separately, using vga::configure_band_list.
+   */
+  explicit Simulator(Timing const &);
+
+  /*
+   * Runs the driver through one complete frame, from line 0 through the end
+   * of active video.  The frame image and line log are replaced.
+   */
+  void run_frame();
+
+  /*
+   * Models a producer that can't keep up: rasterize_ahead doesn't get to run
+   * during the count visible lines starting at first_line, as if a slow
+   * rasterizer or a long interrupt had it stalled.  This applies to every
+   * frame run until it's changed; a count of zero turns it off.
+   */
+  void stall_producer(unsigned first_line, unsigned count);
+
+  /*
+   * Accessors for the most recent frame: video_pixels wide, and as tall as
+   * the number of active video lines.  Pixels are raw 8-bit port values.
+   */
+  unsigned get_width() const { return _width; }
+  unsigned get_height() const { return _height; }
+  Pixel const *get_frame() const { return _frame.data(); }
+
+  /*
+   * The per-line log for the most recent frame, one entry per line.
+   */
+  std::vector<LineRecord> const &get_lines() const { return _lines; }
+
+  /*
+   * Writes the most recent frame as a binary PPM.  The palette maps port
+   * values to colors; if omitted, default_palette is used.  Returns false if
+   * the file could not be written.
+   */
+  bool write_ppm(char const *path, Rgb const *palette = nullptr) const;
+
+  /*
+   * Writes the line log for the most recent frame as text, one line each.
+   * If host_time is false, the rasterize_ns column is left out, so that the
+   * log is the same on every run -- as for comparison against a golden log.
+   */
+  void write_log(std::FILE *, bool host_time = true) const;
+
+  /*
+   * A palette decoding 8-bit port values through the common 2-2-2 resistor
+   * DAC: red in bits 1:0, green in bits 3:2, blue in bits 5:4.  Bits 7:6 are
+   * ignored.
+   */
+  static Rgb const *default_palette();
+
+private:
+  unsigned _width;
+  unsigned _height;
+  std::vector<Pixel> _frame;
+  std::vector<LineRecord> _lines;
+  // The video port holds its last value between transfers, as does GPIOE.
+  Pixel _port;
+  // See stall_producer.
+  unsigned _stall_first;
+  unsigned _stall_count;
+
+  void step(LineRecord &);
+  void scan_out(LineRecord &);
+};
+
+}  // namespace sim
+}  // namespace vga
+
+#endif  // VGA_SIM_SIM_H
@@ -0,0 +1,166 @@
+/*
+ * Randomized check of bitblt against a pixel-at-a-time model, over every
+ * raster op, with and without masks, at every alignment, including blocks
+ * overlapping within one Bitmap.  Also checks the word-streaming kernel that
+ * bitblt leans on, shift_words, against its reference implementation.
+ *
+ * Usage: bitblt [iterations]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vga/bitmap.h"
+#include "vga/shift_words.h"
+
+using etl::armv7m::Word;
+using vga::Bitmap;
+using vga::RasterOp;
+
+namespace {
+
+constexpr unsigned width = 128, height = 20;
+constexpr unsigned stride = width / 32;
+constexpr unsigned words = stride * height;
+
+// A small xorshift generator, so runs are repeatable everywhere.
+std::uint32_t rng_state = 1;
+
+std::uint32_t rng() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+unsigned rng(unsigned n) { return rng() % n; }
+
+bool get(Word const *b, unsigned x, unsigned y) {
+  return (b[y * stride + x / 32] >> (x % 32)) & 1;
+}
+
+void put(Word *b, unsigned x, unsigned y, bool v) {
+  auto &w = b[y * stride + x / 32];
+  if (v) {
+    w |= Word(1) << (x % 32);
+  } else {
+    w &= ~(Word(1) << (x % 32));
+  }
+}
+
+bool combine(RasterOp op, bool s, bool d) {
+  switch (op) {
+    case RasterOp::copy:      return s;
+    case RasterOp::intersect: return d && s;
+    case RasterOp::set:       return d || s;
+    case RasterOp::toggle:    return d != s;
+    case RasterOp::clear:     return d && !s;
+  }
+  return d;
+}
+
+bool check_bitblt(unsigned iteration) {
+  // Guard words either side of each buffer catch stray writes.
+  static Word a[words + 2 * stride], b[words + 2 * stride], mask[words];
+  static Word expected[words], source_copy[words];
+  for (auto &w : a) w = rng();
+  for (auto &w : b) w = rng();
+  for (auto &w : mask) w = rng();
+
+  Word guards[4][stride];
+  Word *const guard_at[4] = { a, a + stride + words, b, b + stride + words };
+  for (unsigned g = 0; g < 4; ++g) {
+    std::memcpy(guards[g], guard_at[g], sizeof(guards[g]));
+  }
+
+  bool same = rng(2);
+  bool use_mask = rng(3) == 0;
+  auto op = RasterOp(rng(5));
+
+  unsigned w = rng(4) == 0 ? rng(8) + 1 : rng(width) + 1;
+  unsigned h = rng(height) + 1;
+  unsigned sx = rng(width - w + 1), sy = rng(height - h + 1);
+  unsigned dx = rng(width - w + 1), dy = rng(height - h + 1);
+  unsigned mx = rng(width - w + 1), my = rng(height - h + 1);
+
+  Word *src = a + stride;
+  Word *dst = same ? src : b + stride;
+
+  std::memcpy(source_copy, src, sizeof(source_copy));
+  std::memcpy(expected, dst, sizeof(expected));
+  for (unsigned y = 0; y < h; ++y) {
+    for (unsigned x = 0; x < w; ++x) {
+      if (use_mask && !get(mask, mx + x, my + y)) continue;
+      bool s = get(source_copy, sx + x, sy + y);
+      bool d = get(expected, dx + x, dy + y);
+      put(expected, dx + x, dy + y, combine(op, s, d));
+    }
+  }
+
+  Bitmap source_bm { src, width, height, int(stride) };
+  Bitmap dest_bm { dst, width, height, int(stride) };
+  Bitmap mask_bm { mask, width, height, int(stride) };
+  Bitmap::Block blk { dx, dy, w, h };
+  if (use_mask) {
+    vga::bitblt(source_bm, sx, sy, mask_bm, mx, my, dest_bm, blk, op);
+  } else {
+    vga::bitblt(source_bm, sx, sy, dest_bm, blk, op);
+  }
+
+  bool ok = std::memcmp(expected, dst, sizeof(expected)) == 0;
+  for (unsigned g = 0; g < 4; ++g) {
+    ok = ok && std::memcmp(guards[g], guard_at[g], sizeof(guards[g])) == 0;
+  }
+  if (!ok) {
+    std::printf("bitblt: iteration %u: same=%d mask=%d op=%d %ux%u "
+                "from (%u,%u) to (%u,%u)\n",
+                iteration, same, use_mask, int(op), w, h, sx, sy, dx, dy);
+  }
+  return ok;
+}
+
+bool check_shift_words(unsigned iteration) {
+  static Word source[66], expected[66], actual[66];
+  for (auto &w : source) w = rng();
+
+  unsigned count = rng(64);
+  Word shift = rng(31) + 1;
+  unsigned skip = rng(2);
+  for (unsigned i = 0; i < 66; ++i) expected[i] = actual[i] = ~Word(i);
+
+  shift_words_reference(source + skip, expected, count, shift);
+  shift_words(source + skip, actual, count, shift);
+
+  bool ok = std::memcmp(expected, actual, sizeof(actual)) == 0;
+  for (unsigned i = 0; ok && i < count; ++i) {
+    Word model = (source[skip + i] >> shift)
+               | (source[skip + i + 1] << (32 - shift));
+    ok = actual[i] == model;
+  }
+  if (!ok) {
+    std::printf("shift_words: iteration %u: count=%u shift=%u\n",
+                iteration, count, unsigned(shift));
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 0))
+                                 : 20000;
+
+  unsigned failures = 0;
+  for (unsigned i = 0; i < iterations; ++i) {
+    if (!check_bitblt(i)) ++failures;
+    if (!check_shift_words(i)) ++failures;
+    if (failures >= 10) break;
+  }
+
+  if (failures) {
+    std::printf("%u failures\n", failures);
+    return 1;
+  }
+  return 0;
+}
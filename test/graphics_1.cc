@@ -0,0 +1,121 @@
+/*
+ * Randomized check that Graphics1 draws the same lines whether or not its
+ * framebuffer is in bit-band memory.  The two cases take different code
+ * paths: one store per pixel through the bit-band alias, or read-modify-write
+ * of whole words.
+ *
+ * To reach the bit-band path on a host, we map memory where the SRAM and its
+ * bit-band alias would be, and read pixels back out of the alias.  If those
+ * addresses aren't available, the test is skipped.
+ *
+ * Usage: graphics_1 [iterations]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#include "vga/graphics_1.h"
+
+using etl::armv7m::Word;
+using vga::Bitmap;
+using vga::Graphics1;
+
+namespace {
+
+constexpr unsigned width = 128, height = 64;
+constexpr unsigned stride = width / 32;
+
+constexpr std::uintptr_t sram_base = 0x20000000;
+constexpr std::uintptr_t bitband_base = 0x22000000;
+
+// A small xorshift generator, so runs are repeatable everywhere.
+std::uint32_t rng_state = 1;
+
+std::uint32_t rng() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+int rng(int lo, int hi) { return lo + int(rng() % unsigned(hi - lo + 1)); }
+
+void *map_at(std::uintptr_t addr, std::size_t size) {
+  void *p = mmap(reinterpret_cast<void *>(addr), size,
+                 PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  return p == reinterpret_cast<void *>(addr) ? p : nullptr;
+}
+
+bool get(Word const *b, unsigned x, unsigned y) {
+  return (b[y * stride + x / 32] >> (x % 32)) & 1;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 0))
+                                 : 20000;
+
+  // Graphics1 only uses the framebuffer's address to find its alias, so the
+  // SRAM side just needs to exist.
+  auto sram = static_cast<Word *>(map_at(sram_base, stride * height * 4));
+  auto alias = static_cast<Word *>(map_at(bitband_base, width * height * 4));
+  if (!sram || !alias) {
+    std::printf("can't map bit-band region; skipping\n");
+    return 0;
+  }
+
+  static Word words[stride * height];
+  Graphics1 gb(Bitmap{sram, width, height, int(stride)});
+  Graphics1 gw(Bitmap{words, width, height, int(stride)});
+
+  unsigned failures = 0;
+  for (unsigned i = 0; i < iterations && failures < 10; ++i) {
+    std::memset(alias, 0, width * height * 4);
+    std::memset(words, 0, sizeof(words));
+
+    // Favor the special cases -- vertical, horizontal and diagonal -- and
+    // lines that need clipping.
+    int x1 = rng(-20, width + 20), y1 = rng(-20, height + 20);
+    int x2, y2;
+    switch (rng() % 5) {
+      case 0:  x2 = x1; y2 = rng(-20, height + 20); break;
+      case 1:  x2 = rng(-20, width + 20); y2 = y1; break;
+      case 2:  { int d = rng(-40, 40); x2 = x1 + d; y2 = y1 + d; } break;
+      case 3:  { int d = rng(-40, 40); x2 = x1 + d; y2 = y1 - d; } break;
+      default: x2 = rng(-20, width + 20); y2 = rng(-20, height + 20); break;
+    }
+
+    gb.set_line(x1, y1, x2, y2);
+    gw.set_line(x1, y1, x2, y2);
+
+    bool ok = true;
+    for (unsigned y = 0; y < height; ++y) {
+      for (unsigned x = 0; x < width; ++x) {
+        ok = ok && (alias[y * width + x] != 0) == get(words, x, y);
+      }
+    }
+    // Endpoints within the Bitmap are always drawn.
+    if (unsigned(x1) < width && unsigned(y1) < height) {
+      ok = ok && get(words, x1, y1);
+    }
+    if (unsigned(x2) < width && unsigned(y2) < height) {
+      ok = ok && get(words, x2, y2);
+    }
+
+    if (!ok) {
+      std::printf("line (%d, %d) - (%d, %d): paths differ\n", x1, y1, x2, y2);
+      ++failures;
+    }
+  }
+
+  if (failures) {
+    std::printf("%u failures\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,480 @@
+/*
+ * Randomized check of Graphics8's drawing operations against simple per-pixel
+ * references.
+ *
+ * Each case draws into a small window -- a Graphics8 with its own stride and
+ * alignment, surrounded by guard bytes -- and into a large canvas that holds
+ * the whole shape unclipped.  The canvas is checked against a reference, and
+ * the window must match the corresponding part of the canvas, without a byte
+ * changing outside it.  Lines are the exception: clipping moves their
+ * endpoints, so a clipped line need only stay close to the true one.
+ *
+ * Usage: graphics_8 [iterations]
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vga/graphics_8.h"
+
+using vga::Graphics8;
+using Color = Graphics8::Color;
+using Point = Graphics8::Point;
+
+namespace {
+
+// The canvas is large enough that every shape fits unclipped; the window
+// covers some part of its middle, at some offset.
+constexpr int canvas_width = 256, canvas_height = 192;
+constexpr int max_window = 100, guard = 64;
+constexpr unsigned window_bytes = guard * 2 + max_window * (max_window + 8);
+
+Color canvas_pixels[canvas_width * canvas_height];
+Color reference_pixels[canvas_width * canvas_height];
+Color window_bytes_in[window_bytes];
+Color window_noise[window_bytes];
+
+// A small xorshift generator, so runs are repeatable everywhere.
+std::uint32_t rng_state = 1;
+
+std::uint32_t rng() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+int rng(int lo, int hi) { return lo + int(rng() % unsigned(hi - lo + 1)); }
+
+Color color() { return Color(rng(1, 255)); }
+
+/*
+ * One case's window: where it sits on the canvas, and how it's laid out.
+ */
+struct Window {
+  int x, y;
+  unsigned width, height;
+  unsigned start;
+  int stride;
+  Graphics8 g;
+
+  Window() {
+    width = rng(1, max_window);
+    height = rng(1, max_window);
+    x = rng(0, canvas_width - int(width));
+    y = rng(0, canvas_height - int(height));
+    start = guard + rng(0, 3);
+    stride = int(width) + rng(0, 8);
+    // Noise all around, but the canvas's pixels inside.
+    for (auto &b : window_noise) b = Color(rng());
+    for (unsigned j = 0; j < height; ++j) {
+      std::memcpy(window_noise + start + j * stride,
+                  canvas_pixels + (y + j) * canvas_width + x,
+                  width);
+    }
+    std::memcpy(window_bytes_in, window_noise, window_bytes);
+    g = Graphics8(window_bytes_in + start, width, height, stride);
+  }
+
+  /*
+   * Replaces the pixels inside with noise, too.
+   */
+  void scramble() {
+    for (unsigned j = 0; j < height; ++j) {
+      for (unsigned i = 0; i < width; ++i) {
+        window_noise[start + j * stride + i] = Color(rng());
+      }
+    }
+    std::memcpy(window_bytes_in, window_noise, window_bytes);
+  }
+
+  bool matches_canvas() const {
+    for (unsigned i = 0; i < window_bytes; ++i) {
+      if (!inside(i) && window_bytes_in[i] != window_noise[i]) return false;
+    }
+    for (unsigned j = 0; j < height; ++j) {
+      for (unsigned i = 0; i < width; ++i) {
+        if (pixel(i, j) != canvas_pixels[(y + j) * canvas_width + x + i]) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  bool untouched_outside() const {
+    for (unsigned i = 0; i < window_bytes; ++i) {
+      if (!inside(i) && window_bytes_in[i] != window_noise[i]) return false;
+    }
+    return true;
+  }
+
+  Color pixel(unsigned i, unsigned j) const {
+    return window_bytes_in[start + j * stride + i];
+  }
+
+  bool changed(unsigned i, unsigned j) const {
+    return pixel(i, j) != window_noise[start + j * stride + i];
+  }
+
+ private:
+  bool inside(unsigned byte) const {
+    if (byte < start) return false;
+    unsigned offset = byte - start;
+    return offset / stride < height && offset % stride < width;
+  }
+};
+
+Graphics8 canvas() {
+  return Graphics8(canvas_pixels, canvas_width, canvas_height);
+}
+
+// Shapes are drawn in other colors, so they show up against this.
+constexpr Color background = 0;
+
+void start_case() {
+  for (auto &p : canvas_pixels) p = background;
+  std::memcpy(reference_pixels, canvas_pixels, sizeof(canvas_pixels));
+}
+
+void reference_set(int x, int y, Color c) {
+  if (x >= 0 && x < canvas_width && y >= 0 && y < canvas_height) {
+    reference_pixels[y * canvas_width + x] = c;
+  }
+}
+
+bool canvas_matches_reference() {
+  return std::memcmp(canvas_pixels, reference_pixels,
+                     sizeof(canvas_pixels)) == 0;
+}
+
+Point random_point_on(Window const &w, int margin) {
+  return { rng(w.x - margin, w.x + int(w.width) + margin),
+           rng(w.y - margin, w.y + int(w.height) + margin) };
+}
+
+Point clamp_to_canvas(Point p) {
+  if (p.x < 0) p.x = 0;
+  if (p.x >= canvas_width) p.x = canvas_width - 1;
+  if (p.y < 0) p.y = 0;
+  if (p.y >= canvas_height) p.y = canvas_height - 1;
+  return p;
+}
+
+/*******************************************************************************
+ * Cases.  Each returns a description of what went wrong, or nullptr.
+ */
+
+char const *check_rects(Window &w) {
+  Color c = color();
+  int x = rng(w.x - 20, w.x + int(w.width) + 10);
+  int y = rng(w.y - 20, w.y + int(w.height) + 10);
+  int width = rng(-2, 40), height = rng(-2, 40);
+  bool outline = rng() & 1;
+
+  auto g = canvas();
+  if (outline) {
+    g.draw_rect_outline(x, y, width, height, c);
+    w.g.draw_rect_outline(x - w.x, y - w.y, width, height, c);
+  } else {
+    g.fill_rect(x, y, width, height, c);
+    w.g.fill_rect(x - w.x, y - w.y, width, height, c);
+  }
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      bool edge = i == 0 || j == 0 || i == width - 1 || j == height - 1;
+      if (!outline || edge) reference_set(x + i, y + j, c);
+    }
+  }
+
+  if (!canvas_matches_reference()) return outline ? "outline" : "fill_rect";
+  if (!w.matches_canvas()) return outline ? "clipped outline"
+                                          : "clipped fill_rect";
+  return nullptr;
+}
+
+/*
+ * Draws a line with Bresenham's algorithm, one pixel at a time.
+ */
+void reference_line(int x1, int y1, int x2, int y2, Color c) {
+  int dx = std::abs(x2 - x1), dy = -std::abs(y2 - y1);
+  int sx = x1 < x2 ? 1 : -1, sy = y1 < y2 ? 1 : -1;
+  int error = dx + dy;
+  for (;;) {
+    reference_set(x1, y1, c);
+    if (x1 == x2 && y1 == y2) return;
+    int e2 = error * 2;
+    if (e2 >= dy) { error += dy; x1 += sx; }
+    if (e2 <= dx) { error += dx; y1 += sy; }
+  }
+}
+
+/*
+ * Distance from pixel (x, y) to the segment from a to b.
+ */
+double distance_to_segment(int x, int y, Point a, Point b) {
+  double dx = b.x - a.x, dy = b.y - a.y;
+  double len2 = dx * dx + dy * dy;
+  double t = len2 ? ((x - a.x) * dx + (y - a.y) * dy) / len2 : 0;
+  if (t < 0) t = 0;
+  if (t > 1) t = 1;
+  return std::hypot(a.x + t * dx - x, a.y + t * dy - y);
+}
+
+char const *check_lines(Window &w) {
+  Color c = color();
+  Point a = clamp_to_canvas(random_point_on(w, 40));
+  Point b;
+  // Favor horizontal, vertical and diagonal lines, which clip exactly.
+  switch (rng() % 4) {
+    case 0:  b = { rng(0, canvas_width - 1), a.y }; break;
+    case 1:  b = { a.x, rng(0, canvas_height - 1) }; break;
+    case 2:  { int d = rng(-50, 50); b = { a.x + d, a.y + d }; } break;
+    default: b = random_point_on(w, 40); break;
+  }
+  b = clamp_to_canvas(b);
+
+  canvas().draw_line(a.x, a.y, b.x, b.y, c);
+  w.g.draw_line(a.x - w.x, a.y - w.y, b.x - w.x, b.y - w.y, c);
+  reference_line(a.x, a.y, b.x, b.y, c);
+
+  if (!canvas_matches_reference()) return "draw_line";
+  if (!w.untouched_outside()) return "clipped draw_line outside window";
+
+  auto in_window = [&](Point p) {
+    return unsigned(p.x - w.x) < w.width && unsigned(p.y - w.y) < w.height;
+  };
+  if (in_window(a) && in_window(b)) {
+    return w.matches_canvas() ? nullptr : "draw_line in window";
+  }
+
+  // Clipped: every pixel drawn must be near the true line, and endpoints in
+  // the window must be drawn.
+  for (unsigned j = 0; j < w.height; ++j) {
+    for (unsigned i = 0; i < w.width; ++i) {
+      if (!w.changed(i, j)) continue;
+      if (w.pixel(i, j) != c) return "clipped draw_line color";
+      if (distance_to_segment(w.x + i, w.y + j, a, b) > 1.5) {
+        return "clipped draw_line strays";
+      }
+    }
+  }
+  for (auto p : { a, b }) {
+    if (in_window(p) && w.pixel(p.x - w.x, p.y - w.y) != c) {
+      return "clipped draw_line endpoint";
+    }
+  }
+  return nullptr;
+}
+
+/*
+ * Tests a pixel center against a polygon with the even-odd rule.  Returns -1
+ * if the center is too close to an edge to call.
+ */
+int reference_inside(Point const *points, unsigned count, int x, int y) {
+  double px = x + 0.5, py = y + 0.5;
+  bool inside = false;
+  for (unsigned i = 0; i < count; ++i) {
+    Point a = points[i], b = points[(i + 1) % count];
+    if (a.y == b.y) continue;
+    if (a.y > b.y) { Point t = a; a = b; b = t; }
+    if (py < a.y || py >= b.y) continue;
+    double cx = a.x + (py - a.y) * (b.x - a.x) / double(b.y - a.y);
+    if (std::fabs(cx - px) < 1e-3) return -1;
+    if (cx < px) inside = !inside;
+  }
+  return inside;
+}
+
+char const *check_polygons(Window &w) {
+  Color c = color();
+  unsigned count = rng(3, 8);
+  Point points[8];
+  for (unsigned i = 0; i < count; ++i) {
+    points[i] = clamp_to_canvas(random_point_on(w, 30));
+  }
+
+  canvas().fill_polygon(points, count, c);
+  Point shifted[8];
+  for (unsigned i = 0; i < count; ++i) {
+    shifted[i] = { points[i].x - w.x, points[i].y - w.y };
+  }
+  w.g.fill_polygon(shifted, count, c);
+
+  for (int y = 0; y < canvas_height; ++y) {
+    for (int x = 0; x < canvas_width; ++x) {
+      int in = reference_inside(points, count, x, y);
+      if (in < 0) {
+        reference_pixels[y * canvas_width + x] =
+            canvas_pixels[y * canvas_width + x];
+      } else if (in) {
+        reference_set(x, y, c);
+      }
+    }
+  }
+
+  if (!canvas_matches_reference()) return "fill_polygon";
+  if (!w.matches_canvas()) return "clipped fill_polygon";
+  return nullptr;
+}
+
+char const *check_circles(Window &w) {
+  Color c = color();
+  Point center = random_point_on(w, 20);
+  int radius = rng(0, 40);
+  // Keep the whole circle on the canvas.
+  center.x = std::max(radius, std::min(canvas_width - 1 - radius, center.x));
+  center.y = std::max(radius, std::min(canvas_height - 1 - radius, center.y));
+  bool fill = rng() & 1;
+
+  // The outline goes in the reference.  It should be symmetric, reach out to
+  // the radius along the axes, and stay close to the true circle.
+  Graphics8(reference_pixels, canvas_width, canvas_height)
+      .draw_circle(center.x, center.y, radius, c);
+  int left[canvas_height], right[canvas_height];
+  for (int y = 0; y < canvas_height; ++y) {
+    left[y] = canvas_width;
+    right[y] = -1;
+    for (int x = 0; x < canvas_width; ++x) {
+      if (reference_pixels[y * canvas_width + x] != c) continue;
+      int dx = x - center.x, dy = y - center.y;
+      if (std::fabs(std::hypot(dx, dy) - radius) > 0.75) {
+        return "draw_circle strays";
+      }
+      auto mirror = [&](int mx, int my) {
+        return reference_pixels[(center.y + my) * canvas_width + center.x + mx];
+      };
+      if (mirror(-dx, dy) != c || mirror(dx, -dy) != c || mirror(dy, dx) != c) {
+        return "draw_circle asymmetric";
+      }
+      left[y] = std::min(left[y], x);
+      right[y] = std::max(right[y], x);
+    }
+  }
+  if (left[center.y] != center.x - radius
+      || right[center.y] != center.x + radius) {
+    return "draw_circle has the wrong radius";
+  }
+
+  auto g = canvas();
+  if (fill) {
+    g.fill_circle(center.x, center.y, radius, c);
+    w.g.fill_circle(center.x - w.x, center.y - w.y, radius, c);
+    // The fill is solid out to the outline on each line.
+    for (int y = 0; y < canvas_height; ++y) {
+      for (int x = left[y]; x <= right[y]; ++x) reference_set(x, y, c);
+    }
+  } else {
+    g.draw_circle(center.x, center.y, radius, c);
+    w.g.draw_circle(center.x - w.x, center.y - w.y, radius, c);
+  }
+
+  if (!canvas_matches_reference()) return fill ? "fill_circle" : "draw_circle";
+  if (!w.matches_canvas()) return fill ? "clipped fill_circle"
+                                       : "clipped draw_circle";
+  return nullptr;
+}
+
+/*
+ * Blits an image onto the window, copying, keyed or blended, and checks the
+ * result against per-pixel references.  There's no need for the canvas here.
+ */
+char const *check_blits(Window &w) {
+  static Color image_pixels[64 * 72 + 4];
+  static Color table[1 << 16];
+
+  unsigned width = rng(1, 64), height = rng(1, 64);
+  unsigned stride = width + rng(0, 8);
+  bool bottom_up = rng() & 1;
+  Color *first = image_pixels + rng(0, 3)
+               + (bottom_up ? (height - 1) * stride : 0);
+  Graphics8::Image image{first, width, height,
+                         bottom_up ? -int(stride) : int(stride)};
+
+  // A small alphabet, so the key turns up often.
+  Color alphabet[8];
+  for (auto &a : alphabet) a = Color(rng());
+  for (auto &p : image_pixels) p = alphabet[rng() % 8];
+  Color key = alphabet[rng() % 8];
+
+  Graphics8::BlendTable blend{table, rng() & 1 ? 8u : 6u};
+  unsigned mask = (1u << blend.bits) - 1;
+  for (unsigned i = 0; i < (1u << (2 * blend.bits)); ++i) {
+    table[i] = Color(rng());
+  }
+
+  w.scramble();
+  int x = rng(-int(width), int(w.width));
+  int y = rng(-int(height), int(w.height));
+  int op = rng() % 3;
+  switch (op) {
+    case 0: w.g.blit(image, x, y); break;
+    case 1: w.g.blit_keyed(image, x, y, key); break;
+    case 2: w.g.blit_blended(image, x, y, blend, key); break;
+  }
+
+  if (!w.untouched_outside()) return "blit outside window";
+  for (unsigned j = 0; j < w.height; ++j) {
+    for (unsigned i = 0; i < w.width; ++i) {
+      Color before = window_noise[w.start + j * w.stride + i];
+      Color expected = before;
+      int sx = int(i) - x, sy = int(j) - y;
+      if (unsigned(sx) < width && unsigned(sy) < height) {
+        Color s = image.pixels[sy * image.stride + sx];
+        if (op == 0) {
+          expected = s;
+        } else if (s != key) {
+          expected = op == 1 ? s
+                   : table[((s & mask) << blend.bits) | (before & mask)];
+        }
+      }
+      if (w.pixel(i, j) != expected) {
+        return op == 0 ? "blit" : op == 1 ? "blit_keyed" : "blit_blended";
+      }
+    }
+  }
+  return nullptr;
+}
+
+struct Check {
+  char const *name;
+  char const *(*run)(Window &);
+};
+
+Check const checks[] = {
+  {"rects", check_rects},
+  {"lines", check_lines},
+  {"polygons", check_polygons},
+  {"circles", check_circles},
+  {"blits", check_blits},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned iterations = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 0))
+                                 : 2000;
+
+  unsigned failures = 0;
+  for (auto const &check : checks) {
+    unsigned check_failures = 0;
+    for (unsigned i = 0; i < iterations && check_failures < 10; ++i) {
+      start_case();
+      Window w;
+      if (auto problem = check.run(w)) {
+        std::printf("%s case %u: %s\n", check.name, i, problem);
+        ++check_failures;
+      }
+    }
+    failures += check_failures;
+  }
+
+  if (failures) {
+    std::printf("%u failures\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,13 @@
+#include "vga/test/kernel_benchmark.h"
+
+#include "vga/measurement.h"
+
+namespace vga {
+namespace test {
+
+void benchmark_kernels(unsigned cases, void (*report)(KernelResult const &)) {
+  check_kernels(cases, [] { return mtim_get(); }, report);
+}
+
+}  // namespace test
+}  // namespace vga
@@ -0,0 +1,20 @@
+#ifndef VGA_TEST_KERNEL_BENCHMARK_H
+#define VGA_TEST_KERNEL_BENCHMARK_H
+
+#include "vga/test/kernel_check.h"
+
+namespace vga {
+namespace test {
+
+/*
+ * Runs check_kernels on the target, timed by SysTick, so that each assembly
+ * kernel is both checked against its C++ reference and timed against it.
+ * The application must call mtim_init first.  Interrupts are counted against
+ * whatever they interrupt, so run this with video off.
+ */
+void benchmark_kernels(unsigned cases, void (*report)(KernelResult const &));
+
+}  // namespace test
+}  // namespace vga
+
+#endif  // VGA_TEST_KERNEL_BENCHMARK_H
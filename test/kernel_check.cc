@@ -0,0 +1,309 @@
+#include "vga/test/kernel_check.h"
+
+#include <cstring>
+
+#include "vga/blit_keyed.h"
+#include "vga/copy_words.h"
+#include "vga/shift_words.h"
+#include "vga/rast/unpack_1bpp.h"
+#include "vga/rast/unpack_affine.h"
+#include "vga/rast/unpack_direct_rev.h"
+#include "vga/rast/unpack_p256.h"
+#include "vga/rast/unpack_p256_lerp4.h"
+#include "vga/rast/unpack_p256_lerp4_d4.h"
+#include "vga/rast/unpack_text_10p_attributed.h"
+
+using etl::armv7m::Byte;
+using etl::armv7m::Word;
+
+namespace vga {
+namespace test {
+
+namespace {
+
+constexpr unsigned
+  buffer_words = 512,
+  buffer_bytes = buffer_words * 4,
+  // Outputs start this far into their buffer, after up to three bytes of
+  // misalignment, so there's a guard band before as well as after.
+  guard_bytes = 16,
+  // The largest output of any case: 80 text columns.
+  max_output = 800;
+
+Word input_words[buffer_words];
+Word noise_words[buffer_words];
+Word kernel_words[buffer_words];
+Word reference_words[buffer_words];
+
+Byte * const input = reinterpret_cast<Byte *>(input_words);
+Byte * const noise = reinterpret_cast<Byte *>(noise_words);
+
+Byte palette0[256];
+Byte palette1[256];
+Byte font_row[256];
+// Big enough for 6-bit blending; 8-bit cases keep source pixels below 16.
+Byte blend_table[1 << 12];
+
+// A small xorshift generator, so runs are repeatable everywhere.
+std::uint32_t rng_state = 1;
+
+std::uint32_t rng() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+unsigned rng(unsigned n) { return rng() % n; }
+
+void fill(Byte *b, unsigned n) {
+  for (unsigned i = 0; i < n; ++i) b[i] = Byte(rng());
+}
+
+/*
+ * Runs the cases for one kernel and accumulates its KernelResult.
+ */
+class Tally {
+ public:
+  Tally(char const *name, KernelClock clock)
+    : _result{name, 0, 0, 0, 0, 0},
+      _clock(clock) {}
+
+  KernelResult const &result() const { return _result; }
+
+  /*
+   * Runs one case.  call(out, reference) runs the kernel, or its reference,
+   * writing length bytes at out.  out is offset bytes past the start of the
+   * output area, which is word-aligned.
+   */
+  template <typename Call>
+  void run(unsigned offset, unsigned length, Call call) {
+    auto kernel_out = reinterpret_cast<Byte *>(kernel_words);
+    auto reference_out = reinterpret_cast<Byte *>(reference_words);
+    unsigned begin = guard_bytes + offset;
+
+    fill(noise, buffer_bytes);
+    std::memcpy(kernel_out, noise, buffer_bytes);
+    std::memcpy(reference_out, noise, buffer_bytes);
+
+    unsigned start = now();
+    call(kernel_out + begin, false);
+    unsigned middle = now();
+    call(reference_out + begin, true);
+    unsigned end = now();
+
+    ++_result.cases;
+    _result.kernel_cycles += elapsed(start, middle);
+    _result.reference_cycles += elapsed(middle, end);
+
+    if (std::memcmp(kernel_out, reference_out, buffer_bytes)) {
+      ++_result.mismatches;
+    }
+    if (!untouched_outside(kernel_out, begin, length)
+        || !untouched_outside(reference_out, begin, length)) {
+      ++_result.overruns;
+    }
+  }
+
+ private:
+  KernelResult _result;
+  KernelClock _clock;
+
+  unsigned now() const { return _clock ? _clock() : 0; }
+
+  static unsigned elapsed(unsigned start, unsigned end) {
+    // The clock counts down, and is only 24 bits wide.
+    return (start - end) & 0xFFFFFF;
+  }
+
+  static bool untouched_outside(Byte const *out,
+                                unsigned begin,
+                                unsigned length) {
+    return std::memcmp(out, noise, begin) == 0
+        && std::memcmp(out + begin + length,
+                       noise + begin + length,
+                       buffer_bytes - begin - length) == 0;
+  }
+};
+
+/*
+ * Picks a source pixel from a small random alphabet, so that color keys
+ * actually turn up.
+ */
+class Alphabet {
+ public:
+  explicit Alphabet(unsigned range) {
+    for (auto &c : _chars) c = Byte(rng(range));
+  }
+
+  Byte pick() const { return _chars[rng(8)]; }
+
+ private:
+  Byte _chars[8];
+};
+
+void check_copy_words(Tally &t) {
+  unsigned src = rng(4), dst = rng(4);
+  unsigned count = 1 + rng(max_output / 4);
+  t.run(dst * 4, count * 4, [&](Byte *out, bool reference) {
+    (reference ? copy_words_reference : copy_words)(
+        input_words + src, reinterpret_cast<Word *>(out), count);
+  });
+}
+
+void check_shift_words(Tally &t) {
+  unsigned src = rng(4), dst = rng(4);
+  unsigned count = 1 + rng(max_output / 4);
+  Word shift = 1 + rng(31);
+  t.run(dst * 4, count * 4, [&](Byte *out, bool reference) {
+    (reference ? shift_words_reference : shift_words)(
+        input_words + src, reinterpret_cast<Word *>(out), count, shift);
+  });
+}
+
+void check_blit_words_keyed(Tally &t) {
+  unsigned src = rng(4), dst = rng(4);
+  unsigned count = 1 + rng(max_output / 4);
+  Alphabet alphabet(256);
+  for (unsigned i = 0; i < count * 4; ++i) input[src + i] = alphabet.pick();
+  Word key = alphabet.pick() * 0x01010101u;
+  t.run(dst * 4, count * 4, [&](Byte *out, bool reference) {
+    (reference ? blit_words_keyed_reference : blit_words_keyed)(
+        input + src, reinterpret_cast<Word *>(out), count, key);
+  });
+}
+
+void check_blit_words_blended(Tally &t) {
+  unsigned src = rng(4), dst = rng(4);
+  unsigned count = 1 + rng(max_output / 4);
+  Word bits = rng(2) ? 8 : 6;
+  Alphabet alphabet(bits == 8 ? 16 : 256);
+  for (unsigned i = 0; i < count * 4; ++i) input[src + i] = alphabet.pick();
+  BlendParams params{blend_table, alphabet.pick() * 0x01010101u, bits};
+  t.run(dst * 4, count * 4, [&](Byte *out, bool reference) {
+    (reference ? blit_words_blended_reference : blit_words_blended)(
+        input + src, reinterpret_cast<Word *>(out), count, &params);
+  });
+}
+
+void check_unpack_1bpp(Tally &t) {
+  unsigned words = 1 + rng(max_output / 32);
+  t.run(rng(4), words * 32, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_1bpp_reference : rast::unpack_1bpp_impl)(
+        input_words, palette0, out, words);
+  });
+}
+
+void check_unpack_1bpp_overlay(Tally &t) {
+  unsigned words = 1 + rng(max_output / 32);
+  Byte const *background = input + buffer_bytes / 2;
+  t.run(rng(4), words * 32, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_1bpp_overlay_reference
+               : rast::unpack_1bpp_overlay_impl)(
+        input_words, palette0, out, words, background);
+  });
+}
+
+void check_unpack_affine(Tally &t) {
+  // Textures of 1 to 32 pixels on a side, so shifts of 32 are covered.
+  unsigned a = rng(6), b = rng(6);
+  rast::AffineSpan span{rng(), rng(), rng(), rng(),
+                        32 - a, 32 - a - b, ((1u << b) - 1) << a};
+  unsigned words = 1 + rng(max_output / 4);
+  t.run(rng(4), words * 4, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_affine_reference : rast::unpack_affine_impl)(
+        input, out, words, &span);
+  });
+}
+
+void check_unpack_direct_rev(Tally &t) {
+  unsigned bytes = 1 + rng(max_output);
+  unsigned words = (bytes + 3) / 4;
+  // The input pointer is the end of the line.
+  Byte const *end = input + words * 4 + rng(4);
+  t.run(rng(4), words * 4, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_direct_rev_reference
+               : rast::unpack_direct_rev_impl)(end, out, bytes);
+  });
+}
+
+void check_unpack_p256(Tally &t) {
+  unsigned src = rng(4);
+  unsigned words = 1 + rng(max_output / 4);
+  t.run(rng(4), words * 4, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_p256_reference : rast::unpack_p256_impl)(
+        input + src, out, words, palette0);
+  });
+}
+
+void check_unpack_p256_lerp4(Tally &t) {
+  unsigned src = rng(4);
+  unsigned bytes = 2 + rng(max_output / 4);
+  t.run(rng(4), (bytes - 1) * 4, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_p256_lerp4_reference
+               : rast::unpack_p256_lerp4_impl)(
+        input + src, out, bytes, palette0);
+  });
+}
+
+void check_unpack_p256_lerp4_d4(Tally &t) {
+  unsigned src = rng(4);
+  unsigned bytes = 2 + rng(max_output / 16);
+  t.run(rng(4), (bytes - 1) * 16, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_p256_lerp4_d4_reference
+               : rast::unpack_p256_lerp4_d4_impl)(
+        input + src, out, bytes, palette0, palette1);
+  });
+}
+
+void check_unpack_text_10p_attributed(Tally &t) {
+  unsigned cols = 1 + rng(max_output / 10);
+  t.run(rng(4), cols * 10, [&](Byte *out, bool reference) {
+    (reference ? rast::unpack_text_10p_attributed_reference
+               : rast::unpack_text_10p_attributed_impl)(
+        input_words, font_row, out, cols);
+  });
+}
+
+struct Kernel {
+  char const *name;
+  void (*check)(Tally &);
+};
+
+Kernel const kernels[] = {
+  {"copy_words", check_copy_words},
+  {"shift_words", check_shift_words},
+  {"blit_words_keyed", check_blit_words_keyed},
+  {"blit_words_blended", check_blit_words_blended},
+  {"unpack_1bpp", check_unpack_1bpp},
+  {"unpack_1bpp_overlay", check_unpack_1bpp_overlay},
+  {"unpack_affine", check_unpack_affine},
+  {"unpack_direct_rev", check_unpack_direct_rev},
+  {"unpack_p256", check_unpack_p256},
+  {"unpack_p256_lerp4", check_unpack_p256_lerp4},
+  {"unpack_p256_lerp4_d4", check_unpack_p256_lerp4_d4},
+  {"unpack_text_10p_attributed", check_unpack_text_10p_attributed},
+};
+
+}  // namespace
+
+void check_kernels(unsigned cases,
+                   KernelClock clock,
+                   void (*report)(KernelResult const &)) {
+  fill(palette0, sizeof(palette0));
+  fill(palette1, sizeof(palette1));
+  fill(font_row, sizeof(font_row));
+  fill(blend_table, sizeof(blend_table));
+
+  for (auto const &k : kernels) {
+    Tally t(k.name, clock);
+    for (unsigned i = 0; i < cases; ++i) {
+      fill(input, buffer_bytes);
+      k.check(t);
+    }
+    report(t.result());
+  }
+}
+
+}  // namespace test
+}  // namespace vga
@@ -0,0 +1,53 @@
+#ifndef VGA_TEST_KERNEL_CHECK_H
+#define VGA_TEST_KERNEL_CHECK_H
+
+#include <cstdint>
+
+namespace vga {
+namespace test {
+
+/*
+ * Differential check of the inner-loop kernels -- copy_words, shift_words,
+ * the keyed and blended blits, and every unpacker -- against their C++
+ * references.
+ *
+ * Each case draws random inputs, lengths, and source and destination
+ * alignments, runs the kernel and its reference into two copies of the same
+ * noise-filled buffer, and compares them.  Bytes outside the expected output
+ * must come back untouched from both.
+ *
+ * On the target this pits the assembly against the reference.  On a host the
+ * kernels are the references, so what's left is the check of each kernel's
+ * footprint -- and, under a sanitizer, of its memory accesses.
+ */
+
+struct KernelResult {
+  char const *name;
+  unsigned cases;
+  // Cases where the kernel's output differed from the reference's.
+  unsigned mismatches;
+  // Cases where either wrote outside the expected output.
+  unsigned overruns;
+  // Total time spent in each, as measured by the clock; zero without one.
+  std::uint64_t kernel_cycles;
+  std::uint64_t reference_cycles;
+};
+
+/*
+ * A 24-bit down-counting cycle clock, like SysTick (see mtim_get).
+ */
+using KernelClock = unsigned (*)();
+
+/*
+ * Runs the given number of random cases through each kernel, timing them
+ * with clock if it's not null, and passes the results for each kernel to
+ * report.
+ */
+void check_kernels(unsigned cases,
+                   KernelClock clock,
+                   void (*report)(KernelResult const &));
+
+}  // namespace test
+}  // namespace vga
+
+#endif  // VGA_TEST_KERNEL_CHECK_H
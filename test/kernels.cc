@@ -0,0 +1,35 @@
+/*
+ * Host run of the kernel check in kernel_check.h.  Here the kernels are
+ * their C++ references, so this checks each one's output footprint, over
+ * random lengths and alignments; build with a sanitizer to check its memory
+ * accesses too.  On the target, see kernel_benchmark.h.
+ *
+ * Usage: kernels [cases]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "vga/test/kernel_check.h"
+
+using vga::test::KernelResult;
+
+namespace {
+
+bool failed = false;
+
+void report(KernelResult const &r) {
+  std::printf("%-28s %6u cases %6u mismatches %6u overruns\n",
+              r.name, r.cases, r.mismatches, r.overruns);
+  if (r.mismatches || r.overruns) failed = true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned cases = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 0))
+                            : 2000;
+
+  vga::test::check_kernels(cases, nullptr, report);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Stalls the producer partway through the first of three bands, under each
+ * overrun policy, and checks that the damage stays in that band: every line
+ * of the later bands must still show what was rasterized for it.
+ *
+ * Usage: overrun
+ */
+
+#include <cstdio>
+
+#include "vga/timing.h"
+#include "vga/vga.h"
+#include "vga/sim/sim.h"
+
+using namespace vga;
+
+namespace {
+
+constexpr unsigned band_lines = 200;
+
+/*
+ * Draws each line in a color derived from its line number, so that repeated
+ * lines stand out.
+ */
+class LineColor : public Rasterizer {
+public:
+  RasterInfo rasterize(unsigned cycles_per_pixel,
+                       unsigned line_number,
+                       Pixel *target) override {
+    target[0] = color(line_number);
+    return {
+      .offset = 0,
+      .length = 1,
+      .cycles_per_pixel = cycles_per_pixel * 800,
+      .repeat_lines = 0,
+    };
+  }
+
+  static Pixel color(unsigned line) { return Pixel(line % 251 + 1); }
+};
+
+char const *policy_name(OverrunPolicy p) {
+  switch (p) {
+    case OverrunPolicy::repeat_line: return "repeat_line";
+    case OverrunPolicy::border:      return "border";
+    case OverrunPolicy::skip_band:   return "skip_band";
+  }
+  return "?";
+}
+
+/*
+ * Runs a frame with the producer stalled on lines 50-59.  Returns false if
+ * any line outside the first band is wrong, or if the overrun count doesn't
+ * match the lines lost.
+ */
+bool check(OverrunPolicy policy) {
+  LineColor r;
+  Band const b3 = { &r, band_lines, nullptr };
+  Band const b2 = { &r, band_lines, &b3 };
+  Band const b1 = { &r, band_lines, &b2 };
+  configure_band_list(&b1);
+  configure_overrun_policy(policy, 0);
+
+  sim::Simulator sim(timing_vesa_800x600_60hz);
+  // The first frame primes the queue; stall during the second.
+  sim.run_frame();
+  sim.stall_producer(50, 10);
+  unsigned overruns_before = get_overrun_count();
+  sim.run_frame();
+  unsigned overruns = get_overrun_count() - overruns_before;
+
+  configure_band_list(nullptr);
+  configure_overrun_policy(OverrunPolicy::repeat_line, 0);
+
+  unsigned lost[3] = {0, 0, 0};
+  for (unsigned y = 0; y < sim.get_height(); ++y) {
+    if (sim.get_frame()[y * sim.get_width()] != LineColor::color(y)) {
+      ++lost[y / band_lines];
+    }
+  }
+
+  std::printf("%-12s lost %3u/%u/%u lines, %3u overruns\n",
+              policy_name(policy), lost[0], lost[1], lost[2], overruns);
+  // Under skip_band, the lines abandoned with the band count as overruns.
+  return lost[0] != 0 && lost[1] == 0 && lost[2] == 0
+      && overruns == lost[0];
+}
+
+}  // namespace
+
+int main() {
+  bool ok = check(OverrunPolicy::repeat_line);
+  ok = check(OverrunPolicy::border) && ok;
+  ok = check(OverrunPolicy::skip_band) && ok;
+  return ok ? 0 : 1;
+}
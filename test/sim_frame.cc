@@ -0,0 +1,470 @@
+/*
+ * Renders a frame of one of the scenes below through the host simulator
+ * (sim/sim.h), and compares the line log -- scan buffer shapes, DMA plans,
+ * and a hash of every displayed line -- against a checked-in golden log.
+ *
+ * Usage: sim_frame <golden.log> [--scene <name>] [--update] [--ppm <path>]
+ *
+ * The default scene, "bands", stacks bands of the basic rasterizers; the
+ * others each exercise one of the fancier ones.  Each has its own golden log
+ * in test/golden.
+ *
+ * --update rewrites the golden log instead of checking it; inspect the PPM
+ * (and the diff) before committing the result.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "vga/arena.h"
+#include "vga/effect.h"
+#include "vga/font_10x16.h"
+#include "vga/timing.h"
+#include "vga/vga.h"
+#include "vga/rast/affine.h"
+#include "vga/rast/bitmap_1.h"
+#include "vga/rast/direct.h"
+#include "vga/rast/palette8.h"
+#include "vga/rast/polygons.h"
+#include "vga/rast/solid_color.h"
+#include "vga/rast/spans.h"
+#include "vga/rast/sprites.h"
+#include "vga/rast/text_10x16.h"
+#include "vga/rast/tilemap.h"
+#include "vga/sim/sim.h"
+
+using namespace vga;
+
+static std::string read_file(std::FILE *f) {
+  std::string s;
+  char buf[4096];
+  std::size_t n;
+  while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) s.append(buf, n);
+  return s;
+}
+
+/*
+ * Runs the band list the scene has configured, and returns the line log.
+ */
+static std::string run_frames(char const *ppm_path) {
+  sim::Simulator sim(timing_vesa_800x600_60hz);
+  // The first frame primes the scan buffer queue; compare the second.
+  sim.run_frame();
+  sim.run_frame();
+
+  configure_band_list(nullptr);
+
+  if (ppm_path && !sim.write_ppm(ppm_path)) {
+    std::fprintf(stderr, "can't write %s\n", ppm_path);
+  }
+
+  std::FILE *f = std::tmpfile();
+  sim.write_log(f, false);
+  std::rewind(f);
+  auto log = read_file(f);
+  std::fclose(f);
+  return log;
+}
+
+/*
+ * Fills a Direct's foreground buffer with a pattern that shows off its scale.
+ */
+static void fill_direct(rast::Direct &d) {
+  for (unsigned y = 0; y < d.get_height(); ++y) {
+    for (unsigned x = 0; x < d.get_width(); ++x) {
+      d.get_fg_buffer()[y * d.get_width() + x] = (x ^ y) & 0x3F;
+    }
+  }
+}
+
+static std::string scene_bands(char const *ppm_path) {
+  rast::SolidColor top(800, 0x03);
+
+  rast::Direct direct(800, 120, 4, 4, 100);
+  fill_direct(direct);
+
+  rast::Palette8 palette8(800, 120, 4, 2, 220);
+  for (unsigned i = 0; i < 256; ++i) palette8.get_palette()[i] = i & 0x3F;
+  for (unsigned y = 0; y < 60; ++y) {
+    for (unsigned x = 0; x < 200; ++x) {
+      palette8.get_fg_buffer()[y * 200 + x] = x + y;
+    }
+  }
+
+  rast::Text_10x16 text(font_10x16, 256, 800, 128, 340);
+  text.clear_framebuffer(0x10);
+  char const message[] = "The quick brown fox jumps over the lazy dog.";
+  for (unsigned row = 0; row < text.get_row_count(); ++row) {
+    for (unsigned i = 0; message[i]; ++i) {
+      text.put_char(i + row, row, 0x3F - row, 0x10 + row, message[i]);
+    }
+  }
+
+  rast::Bitmap_1 bitmap(800, 100, 468);
+  bitmap.set_fg_color(0x0C);
+  bitmap.set_bg_color(0x00);
+  auto bits = bitmap.get_bg_bitmap();
+  for (unsigned y = 0; y < 100; ++y) {
+    for (unsigned x = 0; x < 800; x += 32) {
+      *bits.word_addr(x, y) = 0x01010101u << (y % 8);
+    }
+  }
+  bitmap.flip_now();
+
+  rast::SolidColor bottom(800, 0x30);
+
+  Band const b6 = { &bottom,   32, nullptr };
+  Band const b5 = { &bitmap,  100, &b6 };
+  Band const b4 = { &text,    128, &b5 };
+  Band const b3 = { &palette8, 120, &b4 };
+  Band const b2 = { &direct,  120, &b3 };
+  Band const b1 = { &top,     100, &b2 };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * Spans side by side, starting both on and off word boundaries, with
+ * stretched pixels, a short rasterizer, and a black span.
+ */
+static std::string scene_spans(char const *ppm_path) {
+  rast::SolidColor solid(100, 0x0C);
+
+  rast::Direct direct(200, 300, 2, 2);
+  fill_direct(direct);
+
+  rast::Text_10x16 text(font_10x16, 256, 300, 300);
+  text.clear_framebuffer(0x10);
+  char const message[] = "Spans of text";
+  for (unsigned row = 0; row < text.get_row_count(); ++row) {
+    for (unsigned i = 0; message[i]; ++i) {
+      text.put_char(i + row % 8, row, 0x3F - row, 0x10 + row, message[i]);
+    }
+  }
+
+  rast::Palette8 palette8(100, 300, 1, 3);
+  for (unsigned i = 0; i < 256; ++i) palette8.get_palette()[i] = i & 0x3F;
+  for (unsigned y = 0; y < 100; ++y) {
+    for (unsigned x = 0; x < 100; ++x) {
+      palette8.get_fg_buffer()[y * 100 + x] = x * 2 + y;
+    }
+  }
+
+  // The text span is one pixel wider than its rasterizer, so the Palette8
+  // span starts off a word boundary, and the text span's last pixel is
+  // blank.
+  rast::Spans::Span const spans[] = {
+    { &solid,    100 },
+    { &direct,   200 },
+    { &text,     301 },
+    { &palette8, 101 },
+    { nullptr,    98 },
+  };
+  rast::Spans split(spans, 5);
+
+  rast::SolidColor bottom(800, 0x30);
+
+  Band const b2 = { &bottom, 300, nullptr };
+  Band const b1 = { &split,  300, &b2 };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * Sprites over a Direct with 4x4 pixels: overlapping, transparent, and hanging
+ * off each edge of the layer.
+ */
+static std::string scene_sprites(char const *ppm_path) {
+  rast::Direct direct(800, 600, 4, 4);
+  fill_direct(direct);
+
+  // A 16x16 disc with a transparent surround, and an opaque 40x6 bar.
+  static Rasterizer::Pixel disc[16 * 16];
+  for (int y = 0; y < 16; ++y) {
+    for (int x = 0; x < 16; ++x) {
+      int dx = 2 * x - 15, dy = 2 * y - 15;
+      int r2 = dx * dx + dy * dy;
+      disc[y * 16 + x] = r2 > 225 ? 0 : r2 > 120 ? 0x3F : 0x30 + y / 4;
+    }
+  }
+  static Rasterizer::Pixel bar[40 * 6];
+  for (unsigned i = 0; i < 40 * 6; ++i) bar[i] = 0x0C + (i % 40) / 10;
+
+  rast::Sprites sprites(direct, 8, 4, 600);
+  struct { Rasterizer::Pixel const *pixels; unsigned w, h; int x, y; }
+  const layout[] = {
+    { disc, 16, 16,   50,  100 },
+    { disc, 16, 16,   58,  108 },  // Under the first.
+    { bar,  40,  6,   46,  112 },  // Under both.
+    { disc, 16, 16,   -8,  200 },  // Off the left edge.
+    { disc, 16, 16,  192,  300 },  // Off the right edge.
+    { bar,  40,  6,  100,   -3 },  // Off the top.
+    { bar,  40,  6,  150,  597 },  // Off the bottom.
+    { disc, 16, 16,  100,  400 },
+  };
+  for (unsigned i = 0; i < 8; ++i) {
+    auto &s = sprites.get_sprite(i);
+    s = { layout[i].pixels, layout[i].w, layout[i].h, layout[i].x,
+          layout[i].y };
+  }
+  sprites.commit();
+
+  Band const b1 = { &sprites, 600, nullptr };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * A wrapping, finely scrolled Tilemap with a per-line horizontal scroll table,
+ * so rows start at every alignment.
+ */
+static std::string scene_tilemap(char const *ppm_path) {
+  rast::Tilemap tilemap(800, 600, 2, 2, 8, 64, 48, 16);
+
+  for (unsigned t = 0; t < 16; ++t) {
+    auto tile = tilemap.get_tile(t);
+    for (unsigned y = 0; y < 8; ++y) {
+      for (unsigned x = 0; x < 8; ++x) {
+        bool edge = x == 0 || y == 0;
+        tile[y * 8 + x] = edge ? 0x3F : x == y ? 0 : (t * 4 + 3) & 0x3F;
+      }
+    }
+  }
+  auto map = tilemap.get_map();
+  for (unsigned r = 0; r < 48; ++r) {
+    for (unsigned c = 0; c < 64; ++c) map[r * 64 + c] = (r * 3 + c) % 16;
+  }
+
+  // A staircase of horizontal offsets, passing through every alignment.
+  static std::int16_t scroll_x[300];
+  for (unsigned y = 0; y < 300; ++y) {
+    scroll_x[y] = std::int16_t(y % 48 / 4 - 6);
+  }
+  tilemap.set_line_scroll(scroll_x, nullptr);
+  tilemap.set_scroll(-5, 3);
+
+  Band const b1 = { &tilemap, 600, nullptr };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * Two Affine planes over the same texture: one rotated and scaled, and a
+ * perspective floor from a per-line table.
+ */
+static std::string scene_affine(char const *ppm_path) {
+  rast::Affine rotated(800, 300, 4, 2, 5, 5);
+  rast::Affine floor(800, 300, 4, 2, 5, 5, 300);
+
+  // A 32x32 checkerboard of gradients, with a marker in one corner to show
+  // orientation.
+  for (auto affine : { &rotated, &floor }) {
+    auto texture = affine->get_texture();
+    for (unsigned y = 0; y < 32; ++y) {
+      for (unsigned x = 0; x < 32; ++x) {
+        bool dark = ((x / 8) ^ (y / 8)) & 1;
+        bool marker = x < 4 && y < 4;
+        texture[y * 32 + x] = marker ? 0x3F
+                            : dark ? (x / 2) & 0x0F
+                            : 0x30 | (y / 4);
+      }
+    }
+  }
+
+  // About 30 degrees, at half a texel per pixel.
+  rotated.set_transform({ 0, 0, 28378, 16384, -16384, 28378 });
+
+  // Farther lines toward the top, so texels shrink on the way up.
+  static rast::Affine::LineTransform table[150];
+  for (int y = 0; y < 150; ++y) {
+    std::int32_t step = 65536 * 8 / (y + 8);
+    table[y] = { 0x100000 - 100 * step, 65536 * 512 / (y + 8), step, 0 };
+  }
+  floor.set_line_table(table);
+
+  Band const b2 = { &floor,   300, nullptr };
+  Band const b1 = { &rotated, 300, &b2 };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * Polygons overlapping, sharing edges, hanging off-screen, and nearly flat,
+ * with empty lines above and below them.
+ */
+static std::string scene_polygons(char const *ppm_path) {
+  rast::Polygons polygons(800, 600, 2, 2, 8, 64, 8);
+  polygons.set_background(0x01);
+
+  using P = rast::Polygons::Point;
+  // Two triangles sharing a diagonal: they should tile the square exactly.
+  P const upper[] = { { 40, 40 }, { 140, 40 }, { 140, 140 } };
+  P const lower[] = { { 40, 40 }, { 140, 140 }, { 40, 140 } };
+  P const hexagon[] = {
+    { 250, 60 }, { 300, 90 }, { 300, 150 },
+    { 250, 180 }, { 200, 150 }, { 200, 90 },
+  };
+  // Overlaps the hexagon, and is drawn over it.
+  P const diamond[] = { { 300, 80 }, { 360, 140 }, { 300, 200 }, { 240, 140 } };
+  P const off_left[] = { { -100, 200 }, { 60, 230 }, { -40, 270 } };
+  P const off_right[] = { { 380, 180 }, { 1000, 200 }, { 390, 260 } };
+  P const sliver[] = { { 10, 240 }, { 390, 247 }, { 10, 249 } };
+
+  polygons.add_polygon(upper, 3, 0x0C);
+  polygons.add_polygon(lower, 3, 0x30);
+  polygons.add_polygon(hexagon, 6, 0x3C);
+  polygons.add_polygon(diamond, 4, 0x0F);
+  polygons.add_polygon(off_left, 3, 0x33);
+  polygons.add_polygon(off_right, 3, 0x2A);
+  polygons.add_polygon(sliver, 3, 0x3F);
+  polygons.commit();
+
+  Band const b1 = { &polygons, 600, nullptr };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+/*
+ * Raster effects: color bars from a SolidColor, palette splits in a
+ * Palette8, and per-region text shifts, all mid-band.
+ */
+static std::string scene_effects(char const *ppm_path) {
+  rast::SolidColor bars(800, 0);
+  // Each change splits the SolidColor's repeated line.  The one past the end
+  // of the band is applied as the band ends.
+  Effect bar_effects[21];
+  for (unsigned i = 0; i < 21; ++i) {
+    bar_effects[i] = call_effect<rast::SolidColor, Pixel,
+                                 &rast::SolidColor::set_color>(
+        i * 10, bars, Pixel(i < 20 ? 0x01 + i * 3 : 0));
+  }
+
+  rast::Palette8 palette8(800, 200, 4, 4, 200);
+  auto own = palette8.get_palette();
+  for (unsigned i = 0; i < 256; ++i) own[i] = i & 0x3F;
+  for (unsigned y = 0; y < 50; ++y) {
+    for (unsigned x = 0; x < 200; ++x) {
+      palette8.get_fg_buffer()[y * 200 + x] = (x / 25) * 8 + y / 10;
+    }
+  }
+  alignas(4) static Pixel alternate[256];
+  for (unsigned i = 0; i < 256; ++i) alternate[i] = 0x3F - (i & 0x3F);
+  // Recolor one entry partway down, swap palettes lower still, and put both
+  // back at the top.  Line 102 falls within a 4x4 pixel, splitting it.
+  Effect const palette_effects[] = {
+    store_effect(0, &own[10], Pixel(10)),
+    call_effect<rast::Palette8, Pixel *, &rast::Palette8::set_palette>(
+        0, palette8, own),
+    store_effect(102, &own[10], Pixel(0x30)),
+    call_effect<rast::Palette8, Pixel *, &rast::Palette8::set_palette>(
+        150, palette8, alternate),
+  };
+
+  rast::Text_10x16 text(font_10x16, 256, 800, 200, 400);
+  text.clear_framebuffer(0x10);
+  char const message[] = "Effects shift this text";
+  for (unsigned row = 0; row < text.get_row_count(); ++row) {
+    for (unsigned i = 0; message[i]; ++i) {
+      text.put_char(i, row, 0x3F, 0x10 + row, message[i]);
+    }
+  }
+  Effect const text_effects[] = {
+    call_effect<rast::Text_10x16, int, &rast::Text_10x16::set_x_adj>(
+        0, text, 0),
+    call_effect<rast::Text_10x16, int, &rast::Text_10x16::set_x_adj>(
+        56, text, 3),
+    call_effect<rast::Text_10x16, int, &rast::Text_10x16::set_x_adj>(
+        120, text, -5),
+  };
+
+  Band const b3 = { &text, 200, nullptr, text_effects, 3 };
+  Band const b2 = { &palette8, 200, &b3, palette_effects, 4 };
+  Band const b1 = { &bars, 200, &b2, bar_effects, 21 };
+  configure_band_list(&b1);
+  return run_frames(ppm_path);
+}
+
+struct Scene {
+  char const *name;
+  std::string (*render)(char const *ppm_path);
+};
+
+static Scene const scenes[] = {
+  { "bands", scene_bands },
+  { "affine", scene_affine },
+  { "effects", scene_effects },
+  { "polygons", scene_polygons },
+  { "spans", scene_spans },
+  { "sprites", scene_sprites },
+  { "tilemap", scene_tilemap },
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::fprintf(stderr,
+                 "usage: %s <golden.log> [--scene <name>] [--update] "
+                 "[--ppm <path>]\n",
+                 argv[0]);
+    return 2;
+  }
+
+  char const *golden_path = argv[1];
+  bool update = false;
+  char const *ppm_path = nullptr;
+  Scene const *scene = &scenes[0];
+  for (int i = 2; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (std::strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+      ppm_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+      ++i;
+      scene = nullptr;
+      for (auto const &s : scenes) {
+        if (std::strcmp(argv[i], s.name) == 0) scene = &s;
+      }
+      if (!scene) {
+        std::fprintf(stderr, "unknown scene: %s\n", argv[i]);
+        return 2;
+      }
+    } else {
+      std::fprintf(stderr, "unknown argument: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  arena_reset();
+  auto log = scene->render(ppm_path);
+
+  if (update) {
+    std::FILE *f = std::fopen(golden_path, "w");
+    if (!f || std::fwrite(log.data(), 1, log.size(), f) != log.size()
+        || std::fclose(f) != 0) {
+      std::fprintf(stderr, "can't write %s\n", golden_path);
+      return 1;
+    }
+    return 0;
+  }
+
+  std::FILE *f = std::fopen(golden_path, "r");
+  if (!f) {
+    std::fprintf(stderr, "can't read %s\n", golden_path);
+    return 1;
+  }
+  auto golden = read_file(f);
+  std::fclose(f);
+
+  if (log == golden) return 0;
+
+  // Report the first line that differs, counting from 1 as editors do.
+  unsigned line = 1;
+  std::size_t i = 0;
+  while (i < log.size() && i < golden.size() && log[i] == golden[i]) {
+    if (log[i] == '\n') ++line;
+    ++i;
+  }
+  std::fprintf(stderr, "%s: frame differs from golden at line %u\n",
+               golden_path, line);
+  return 1;
+}
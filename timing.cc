@@ -1,5 +1,7 @@
 #include "vga/timing.h"
 
+#include "vga/timing_solver.h"
+
 namespace vga {
 
 Timing const timing_vesa_640x480_60hz = {
@@ -63,4 +65,76 @@ Timing const timing_vesa_800x600_60hz = {
   .vsync_polarity   = Timing::Polarity::positive,
 };
 
+/*
+ * Solved timings.  Modes are from the VESA DMT standard, except 640x400 and
+ * 720x400, which are the IBM VGA text modes.
+ */
+
+using Polarity = Timing::Polarity;
+
+static constexpr ModeDescription
+  mode_640x400_70hz = {
+    25175000,
+    640, 16, 96, 48, Polarity::negative,
+    400, 12, 2, 35, Polarity::positive,
+  },
+  mode_720x400_70hz = {
+    28322000,
+    720, 18, 108, 54, Polarity::negative,
+    400, 12, 2, 35, Polarity::positive,
+  },
+  mode_640x480_72hz = {
+    31500000,
+    640, 24, 40, 128, Polarity::negative,
+    480, 9, 3, 28, Polarity::negative,
+  },
+  mode_640x480_75hz = {
+    31500000,
+    640, 16, 64, 120, Polarity::negative,
+    480, 1, 3, 16, Polarity::negative,
+  },
+  mode_800x600_56hz = {
+    36000000,
+    800, 24, 72, 128, Polarity::positive,
+    600, 1, 2, 22, Polarity::positive,
+  },
+  mode_800x600_72hz = {
+    50000000,
+    800, 56, 120, 64, Polarity::positive,
+    600, 37, 6, 23, Polarity::positive,
+  },
+  mode_848x480_60hz = {
+    33750000,
+    848, 16, 112, 112, Polarity::positive,
+    480, 6, 8, 23, Polarity::positive,
+  };
+
+// Limits for 800x600@72, which needs an overclock.  See timing.h.
+static constexpr SolverLimits overclocked_limits = { 8000000, 200000000, 1000 };
+
+static constexpr TimingSolution
+  solution_640x400_70hz = solve_timing(mode_640x400_70hz),
+  solution_720x400_70hz = solve_timing(mode_720x400_70hz),
+  solution_640x480_72hz = solve_timing(mode_640x480_72hz),
+  solution_640x480_75hz = solve_timing(mode_640x480_75hz),
+  solution_800x600_56hz = solve_timing(mode_800x600_56hz),
+  solution_800x600_72hz = solve_timing(mode_800x600_72hz, overclocked_limits),
+  solution_848x480_60hz = solve_timing(mode_848x480_60hz);
+
+static_assert(solution_640x400_70hz.found, "640x400@70 unsolvable");
+static_assert(solution_720x400_70hz.found, "720x400@70 unsolvable");
+static_assert(solution_640x480_72hz.found, "640x480@72 unsolvable");
+static_assert(solution_640x480_75hz.found, "640x480@75 unsolvable");
+static_assert(solution_800x600_56hz.found, "800x600@56 unsolvable");
+static_assert(solution_800x600_72hz.found, "800x600@72 unsolvable");
+static_assert(solution_848x480_60hz.found, "848x480@60 unsolvable");
+
+Timing const timing_vesa_640x400_70hz = solution_640x400_70hz.timing;
+Timing const timing_vesa_720x400_70hz = solution_720x400_70hz.timing;
+Timing const timing_vesa_640x480_72hz = solution_640x480_72hz.timing;
+Timing const timing_vesa_640x480_75hz = solution_640x480_75hz.timing;
+Timing const timing_vesa_800x600_56hz = solution_800x600_56hz.timing;
+Timing const timing_vesa_800x600_72hz = solution_800x600_72hz.timing;
+Timing const timing_vesa_848x480_60hz = solution_848x480_60hz.timing;
+
 }  // namespace vga
@@ -71,6 +71,22 @@ struct Timing {
 extern Timing const timing_vesa_640x480_60hz;
 extern Timing const timing_vesa_800x600_60hz;
 
+/*
+ * Further canned timings, produced by the solver in timing_solver.h.  The
+ * comment on each gives the CPU clock and cycles per pixel it settled on; more
+ * cycles per pixel means more time to rasterize each pixel.
+ *
+ * (!) 800x600@72 has a 50MHz pixel clock, which needs a 200MHz CPU clock --
+ * overclocking the STM32F407 beyond its rated 168MHz.  Use at your own risk.
+ */
+extern Timing const timing_vesa_640x400_70hz;  // 151MHz, 6 cycles/pixel
+extern Timing const timing_vesa_720x400_70hz;  // 113MHz, 4 cycles/pixel
+extern Timing const timing_vesa_640x480_72hz;  // 126MHz, 4 cycles/pixel
+extern Timing const timing_vesa_640x480_75hz;  // 126MHz, 4 cycles/pixel
+extern Timing const timing_vesa_800x600_56hz;  // 144MHz, 4 cycles/pixel
+extern Timing const timing_vesa_800x600_72hz;  // 200MHz, 4 cycles/pixel (!)
+extern Timing const timing_vesa_848x480_60hz;  // 135MHz, 4 cycles/pixel
+
 }  // namespace vga
 
 #endif  // VGA_TIMING_H
@@ -0,0 +1,197 @@
+#ifndef VGA_TIMING_SOLVER_H
+#define VGA_TIMING_SOLVER_H
+
+#include <cstdint>
+
+#include "vga/timing.h"
+
+/*
+ * Derives a Timing -- including the CPU clock configuration -- from a display
+ * mode as published by VESA (DMT) or generated by CVT.
+ *
+ * Because the pixel clock is the CPU clock divided by cycles_per_pixel, the
+ * solver searches the PLL settings for a CPU clock that's close to an integer
+ * multiple of the mode's pixel clock.  Among the settings within tolerance, it
+ * prefers the most CPU cycles per pixel, then the smallest pixel clock error.
+ *
+ * This is all constexpr, so canned timings can be solved at compile time (see
+ * timing.cc).  tool/solve_timing.cc wraps it up for use on a host.
+ */
+
+namespace vga {
+
+/*
+ * A display mode, as it appears in the standards.  Horizontal parameters are
+ * in pixels, vertical in lines.
+ */
+struct ModeDescription {
+  std::uint32_t pixel_clock_hz;
+
+  std::uint16_t h_active;
+  std::uint16_t h_front_porch;
+  std::uint16_t h_sync;
+  std::uint16_t h_back_porch;
+  Timing::Polarity hsync_polarity;
+
+  std::uint16_t v_active;
+  std::uint16_t v_front_porch;
+  std::uint16_t v_sync;
+  std::uint16_t v_back_porch;
+  Timing::Polarity vsync_polarity;
+};
+
+/*
+ * Limits on the solver's search.  The defaults suit an STM32F407 at 3.3V with
+ * the 8MHz crystal assumed throughout.
+ */
+struct SolverLimits {
+  std::uint32_t crystal_hz = 8000000;
+  std::uint32_t max_cpu_hz = 168000000;
+  // Acceptable pixel clock error, in parts per million.  VESA allows 0.5%.
+  std::uint32_t max_error_ppm = 1000;
+};
+
+struct TimingSolution {
+  // If false, nothing was within tolerance and the rest is meaningless.
+  bool found;
+  Timing timing;
+  std::uint32_t cpu_hz;
+  // Error in the achieved pixel clock relative to the mode's, in parts per
+  // million.
+  std::uint32_t error_ppm;
+};
+
+namespace solver_detail {
+
+// Hardware limits, from RM0090.
+static constexpr std::uint32_t
+  min_vco_in_hz = 1000000,
+  max_vco_in_hz = 2000000,
+  min_vco_out_hz = 100000000,
+  max_vco_out_hz = 432000000,
+  max_apb1_hz = 42000000,
+  max_apb2_hz = 84000000,
+  max_pll48_hz = 48000000,
+  // Flash wait states are needed per 30MHz of CPU clock at 2.7-3.6V.
+  flash_hz_per_wait_state = 30000000;
+
+// Picks the smallest power-of-two prescaler keeping a bus under max_hz.
+constexpr unsigned bus_divisor(std::uint32_t cpu_hz, std::uint32_t max_hz) {
+  unsigned d = 1;
+  while (cpu_hz / d > max_hz) d *= 2;
+  return d;
+}
+
+// Empirical DMA startup compensation, in pixels, interpolated from the
+// hand-tuned canned modes: 19 at 4 cycles/pixel (memory-to-memory DMA), and
+// about 150 cycles' worth when TIM1 paces the transfer.
+constexpr std::uint16_t video_lead(unsigned cycles_per_pixel) {
+  return cycles_per_pixel == 4
+      ? 19
+      : (150 + cycles_per_pixel / 2) / cycles_per_pixel;
+}
+
+}  // namespace solver_detail
+
+constexpr TimingSolution solve_timing(ModeDescription const &mode,
+                                      SolverLimits const &limits
+                                          = SolverLimits()) {
+  using namespace solver_detail;
+  using u64 = std::uint64_t;
+
+  TimingSolution best{};
+  unsigned best_m = 0, best_n = 0, best_p = 0;
+
+  u64 const crystal = limits.crystal_hz;
+  u64 const pclk = mode.pixel_clock_hz;
+
+  for (unsigned m = 2; m <= 63; ++m) {
+    if (crystal < u64(min_vco_in_hz) * m) break;
+    if (crystal > u64(max_vco_in_hz) * m) continue;
+
+    for (unsigned n = 50; n <= 432; ++n) {
+      u64 vco = crystal * n / m;
+      if (vco < min_vco_out_hz || vco > max_vco_out_hz) continue;
+
+      for (unsigned p = 2; p <= 8; p += 2) {
+        u64 cpu_hz = vco / p;
+        if (cpu_hz > limits.max_cpu_hz) continue;
+
+        // Horizontal timing is generated on APB1, so cycles_per_pixel must be
+        // expressible in APB1 timer cycles.  (Timers on a divided APB run at
+        // twice the bus rate, hence the /2.)  See configure_timing.
+        unsigned apb1 = bus_divisor(cpu_hz, max_apb1_hz);
+        unsigned step = apb1 > 1 ? apb1 / 2 : 1;
+
+        // Try the multiples of step on either side of the ideal ratio.
+        unsigned ideal = unsigned(cpu_hz / pclk);
+        unsigned lower = ideal / step * step;
+        for (unsigned cpp = lower; cpp <= lower + step; cpp += step) {
+          if (cpp < 4) continue;
+
+          // Error is |actual - target| / target, where actual is
+          // crystal * n / (m * p * cpp).  Kept in integers.
+          u64 num = crystal * n;
+          u64 den = pclk * m * p * cpp;
+          u64 diff = num > den ? num - den : den - num;
+          u64 error_ppm = diff * 1000000 / den;
+          if (error_ppm > limits.max_error_ppm) continue;
+
+          bool better = !best.found
+                     || cpp > best.timing.cycles_per_pixel
+                     || (cpp == best.timing.cycles_per_pixel
+                         && (error_ppm < best.error_ppm
+                             // On a tie, prefer the higher PLL input
+                             // frequency, which has less jitter.
+                             || (error_ppm == best.error_ppm && m < best_m)));
+          if (!better) continue;
+
+          best.found = true;
+          best.cpu_hz = std::uint32_t(cpu_hz);
+          best.error_ppm = std::uint32_t(error_ppm);
+          best.timing.cycles_per_pixel = std::uint16_t(cpp);
+          best_m = m;
+          best_n = n;
+          best_p = p;
+        }
+      }
+    }
+  }
+
+  if (!best.found) return best;
+
+  auto &t = best.timing;
+  u64 vco = crystal * best_n / best_m;
+  unsigned q = unsigned((vco + max_pll48_hz - 1) / max_pll48_hz);
+  if (q < 2) q = 2;
+
+  t.clock_config.crystal_hz = limits.crystal_hz;
+  t.clock_config.crystal_divisor = best_m;
+  t.clock_config.vco_multiplier = best_n;
+  t.clock_config.general_divisor = best_p;
+  t.clock_config.pll48_divisor = q;
+  t.clock_config.ahb_divisor = 1;
+  t.clock_config.apb1_divisor = bus_divisor(best.cpu_hz, max_apb1_hz);
+  t.clock_config.apb2_divisor = bus_divisor(best.cpu_hz, max_apb2_hz);
+  t.clock_config.flash_latency = (best.cpu_hz - 1) / flash_hz_per_wait_state;
+
+  t.line_pixels = mode.h_active + mode.h_front_porch + mode.h_sync
+                + mode.h_back_porch;
+  t.sync_pixels = mode.h_sync;
+  t.back_porch_pixels = mode.h_back_porch;
+  t.video_lead = video_lead(t.cycles_per_pixel);
+  t.video_pixels = mode.h_active;
+  t.hsync_polarity = mode.hsync_polarity;
+
+  t.vsync_start_line = mode.v_front_porch;
+  t.vsync_end_line = t.vsync_start_line + mode.v_sync;
+  t.video_start_line = t.vsync_end_line + mode.v_back_porch;
+  t.video_end_line = t.video_start_line + mode.v_active;
+  t.vsync_polarity = mode.vsync_polarity;
+
+  return best;
+}
+
+}  // namespace vga
+
+#endif  // VGA_TIMING_SOLVER_H
@@ -0,0 +1,340 @@
+/*
+ * Host tool: predicts whether a band list can be rasterized in time, without
+ * the bother of building it and squinting at a monitor.
+ *
+ * Usage:
+ *   check_budget [--derate=F] [--zero-copy] [DESCRIPTION]
+ *
+ * The description (read from stdin if no file is given) names a canned timing
+ * and lists the bands from the top of the screen down:
+ *
+ *   # 400x300 chunky graphics over a status line.
+ *   timing 800x600@60
+ *   band 584 palette8 scale_x=2 scale_y=2
+ *   band 16  text_10x16
+ *
+ * Band parameters default to the full width of the mode and a scale of 1.
+ * Rasterizer types: solid_color, direct, direct_mirror, palette8,
+ * palette8_mirror, bitmap_1, text_10x16, field_16x4, tilemap, affine,
+ * polygons, blank.  Sprites and Spans are composites whose cost depends on
+ * what they contain, so they're rejected; profile them on the target instead.
+ *
+ * For each band, the tool predicts the cost of one rasterize call, how many
+ * lines each call covers (via repeat_lines), and compares the average cost per
+ * line with the CPU time available per line.  Because the driver queues
+ * scan::lookahead_lines lines ahead of scanout, a single call may run past its
+ * own line, as long as it fits in the queue and the average keeps up.
+ *
+ * Costs come from the cycle counts annotated in the unpackers, where they
+ * exist, and are estimates otherwise.  The contention derating accounts for
+ * the scanout DMA competing with the CPU for the bus matrix during active
+ * video; it's empirical, and adjustable with --derate.  --zero-copy models a
+ * driver built with VGA_ZERO_COPY_SCANOUT: no scan buffer copy, but one line
+ * less of lookahead.  Treat the results as a guide, and confirm marginal cases
+ * with the profiler (profile.h).
+ *
+ * Built by the check_budget target in BUILD; or build with any C++14 host
+ * compiler, with the parent of this repository and etl on the include path,
+ * linking timing.cc.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "vga/scan.h"
+#include "vga/timing.h"
+
+using vga::Timing;
+
+namespace {
+
+struct NamedTiming {
+  char const *name;
+  Timing const *timing;
+};
+
+NamedTiming const timings[] = {
+  { "640x480@60", &vga::timing_vesa_640x480_60hz },
+  { "800x600@60", &vga::timing_vesa_800x600_60hz },
+  { "640x400@70", &vga::timing_vesa_640x400_70hz },
+  { "720x400@70", &vga::timing_vesa_720x400_70hz },
+  { "640x480@72", &vga::timing_vesa_640x480_72hz },
+  { "640x480@75", &vga::timing_vesa_640x480_75hz },
+  { "800x600@56", &vga::timing_vesa_800x600_56hz },
+  { "800x600@72", &vga::timing_vesa_800x600_72hz },
+  { "848x480@60", &vga::timing_vesa_848x480_60hz },
+};
+
+/*
+ * Cost model for a rasterizer type.
+ */
+struct RasterizerModel {
+  char const *name;
+  // Cycles per pixel of the rasterizer's output buffer.
+  double cycles_per_pixel;
+  // Output pixels per line are width / scale_x, or this many if nonzero.
+  unsigned fixed_pixels;
+  // Lines covered by each call are scale_y, or this many if nonzero -- or the
+  // whole band, if ~0U.
+  unsigned fixed_lines;
+  // Whether cycles_per_pixel is measured (as opposed to guessed).
+  bool measured;
+};
+
+RasterizerModel const models[] = {
+  // Stretches one pixel across the line and repeats it to the end of the band.
+  { "solid_color",     0.0,   1, ~0U, true },
+  // copy_words: 128 bytes per ~34 cycles.
+  { "direct",          0.27,  0, 0,   true },
+  { "direct_mirror",   0.75,  0, 0,   false },
+  // unpack_p256: 15 cycles per 4 pixels.
+  { "palette8",        3.75,  0, 0,   true },
+  { "palette8_mirror", 3.75,  0, 0,   false },
+  // unpack_1bpp: 917 cycles per 800 pixels.
+  { "bitmap_1",        1.146, 0, 1,   true },
+  { "text_10x16",      1.6,   0, 1,   false },
+  // unpack_p256_lerp4_d4: 1754 cycles per 800 pixels, two lines per call.
+  { "field_16x4",      2.19,  0, 2,   true },
+  // A word copy per four pixels, plus a map lookup per tile.
+  { "tilemap",         1.5,   0, 0,   false },
+  // unpack_affine: about 10 cycles per pixel, predicted from the TRM.
+  { "affine",          10.0,  0, 0,   false },
+  // Word fills, plus edge stepping; assumes a handful of edges per line.
+  { "polygons",        0.6,   0, 0,   false },
+  { "blank",           0.0,   0, ~0U, true },
+};
+
+// Composite rasterizers, whose cost is that of whatever they contain.  We
+// reject these rather than guess.
+char const *const unmodeled[] = {
+  "sprites",
+  "spans",
+};
+
+// Overhead of a rasterize call: virtual dispatch, prologue, setup.
+constexpr double call_overhead_cycles = 60;
+
+// Driver work per line outside the rasterizer: EAV and PendSV entry and exit,
+// the line state machine, queue management, and DMA setup.
+constexpr double driver_overhead_cycles = 250;
+
+// Cost of copying a line into the scan buffer, per pixel (copy_words).
+constexpr double copy_cycles_per_pixel = 0.27;
+
+struct BandSpec {
+  unsigned lines;
+  RasterizerModel const *model;
+  unsigned width;
+  unsigned scale_x;
+  unsigned scale_y;
+};
+
+RasterizerModel const *find_model(char const *name) {
+  for (auto const &m : models) {
+    if (std::strcmp(m.name, name) == 0) return &m;
+  }
+  return nullptr;
+}
+
+Timing const *find_timing(char const *name) {
+  for (auto const &t : timings) {
+    if (std::strcmp(t.name, name) == 0) return t.timing;
+  }
+  return nullptr;
+}
+
+bool parse(std::FILE *in,
+           Timing const **timing,
+           std::vector<BandSpec> *bands) {
+  char buf[256];
+  unsigned lineno = 0;
+  while (std::fgets(buf, sizeof(buf), in)) {
+    ++lineno;
+    if (char *hash = std::strchr(buf, '#')) *hash = 0;
+
+    char *word = std::strtok(buf, " \t\r\n");
+    if (!word) continue;
+
+    if (std::strcmp(word, "timing") == 0) {
+      char const *name = std::strtok(nullptr, " \t\r\n");
+      *timing = name ? find_timing(name) : nullptr;
+      if (!*timing) {
+        std::fprintf(stderr, "line %u: unknown timing\n", lineno);
+        return false;
+      }
+    } else if (std::strcmp(word, "band") == 0) {
+      if (!*timing) {
+        std::fprintf(stderr, "line %u: band before timing\n", lineno);
+        return false;
+      }
+      char const *count = std::strtok(nullptr, " \t\r\n");
+      char const *type = std::strtok(nullptr, " \t\r\n");
+      BandSpec b = {
+        count ? unsigned(std::strtoul(count, nullptr, 0)) : 0,
+        type ? find_model(type) : nullptr,
+        (*timing)->video_pixels,
+        1,
+        1,
+      };
+      for (auto name : unmodeled) {
+        if (type && std::strcmp(type, name) == 0) {
+          std::fprintf(stderr, "line %u: %s is not modeled: its cost depends "
+                       "on what it contains\n", lineno, type);
+          return false;
+        }
+      }
+      if (!b.lines || !b.model) {
+        std::fprintf(stderr, "line %u: expected 'band COUNT TYPE'\n", lineno);
+        return false;
+      }
+      while (char *param = std::strtok(nullptr, " \t\r\n")) {
+        char *eq = std::strchr(param, '=');
+        if (!eq) {
+          std::fprintf(stderr, "line %u: bad parameter %s\n", lineno, param);
+          return false;
+        }
+        *eq = 0;
+        unsigned value = unsigned(std::strtoul(eq + 1, nullptr, 0));
+        if (std::strcmp(param, "width") == 0) {
+          b.width = value;
+        } else if (std::strcmp(param, "scale_x") == 0 && value) {
+          b.scale_x = value;
+        } else if (std::strcmp(param, "scale_y") == 0 && value) {
+          b.scale_y = value;
+        } else {
+          std::fprintf(stderr, "line %u: bad parameter %s\n", lineno, param);
+          return false;
+        }
+      }
+      bands->push_back(b);
+    } else {
+      std::fprintf(stderr, "line %u: unknown directive %s\n", lineno, word);
+      return false;
+    }
+  }
+
+  if (!*timing) {
+    std::fprintf(stderr, "no timing given\n");
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  double derate = -1;
+  bool zero_copy = false;
+  char const *path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--derate=", 9) == 0) {
+      derate = std::strtod(argv[i] + 9, nullptr);
+    } else if (std::strcmp(argv[i], "--zero-copy") == 0) {
+      zero_copy = true;
+    } else if (!path) {
+      path = argv[i];
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--derate=F] [--zero-copy] [DESCRIPTION]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+
+  std::FILE *in = path ? std::fopen(path, "r") : stdin;
+  if (!in) {
+    std::perror(path);
+    return 2;
+  }
+
+  Timing const *timing = nullptr;
+  std::vector<BandSpec> bands;
+  bool ok = parse(in, &timing, &bands);
+  if (path) std::fclose(in);
+  if (!ok) return 2;
+
+  auto const &t = *timing;
+
+  // At 4 cycles per pixel, scanout runs memory-to-memory, flat out; slower
+  // modes pace DMA with TIM1 and leave the bus mostly idle.
+  if (derate < 0) derate = t.cycles_per_pixel == 4 ? 0.75 : 0.9;
+
+  // Scanout DMA starts video_lead pixels before active video does, so the
+  // lead is contended time, not blanking.
+  unsigned scanout_pixels = t.video_pixels + t.video_lead;
+  double active = double(scanout_pixels) * t.cycles_per_pixel;
+  double blank = double(t.line_pixels - scanout_pixels) * t.cycles_per_pixel;
+  double per_line = blank + active * derate - driver_overhead_cycles;
+
+  // In zero-copy mode, scanout reads a working buffer directly, which both
+  // saves the copy and ties that buffer up.
+  double copy_cost = zero_copy ? 0 : copy_cycles_per_pixel;
+  unsigned lookahead = vga::scan::lookahead_lines - (zero_copy ? 1 : 0);
+
+  std::printf("Timing: %u cycles/line (%u blank + %u active), derate %.2f\n",
+              unsigned(t.line_pixels * t.cycles_per_pixel),
+              unsigned(blank), unsigned(active), derate);
+  std::printf("Budget: %.0f cycles/line after driver overhead; "
+              "lookahead %u lines%s\n\n",
+              per_line, lookahead, zero_copy ? " (zero-copy)" : "");
+  std::printf("%-4s %-16s %6s %6s %8s %6s %8s %6s  %s\n",
+              "band", "rasterizer", "lines", "pixels", "cyc/call",
+              "l/call", "cyc/line", "load", "verdict");
+
+  unsigned visible = t.video_end_line - t.video_start_line;
+  unsigned total_lines = 0;
+  bool all_ok = true;
+
+  for (unsigned i = 0; i < bands.size(); ++i) {
+    auto const &b = bands[i];
+    auto const &m = *b.model;
+    total_lines += b.lines;
+
+    unsigned pixels = m.fixed_pixels ? m.fixed_pixels : b.width / b.scale_x;
+    unsigned lines_per_call = m.fixed_lines == ~0U ? b.lines
+                            : m.fixed_lines ? m.fixed_lines
+                            : b.scale_y;
+    if (lines_per_call > b.lines) lines_per_call = b.lines;
+
+    double call = std::strcmp(m.name, "blank") == 0
+        ? 0
+        : call_overhead_cycles + m.cycles_per_pixel * pixels;
+    // The copy into the scan buffer happens once per call, but it comes out
+    // of the per-line budget.
+    double copy = copy_cost * pixels;
+    double per_line_cost = (call + copy) / lines_per_call;
+    double load = per_line_cost / per_line;
+
+    // Averages must keep up, and any single call must fit in the queue.
+    char const *verdict;
+    if (load > 1.0) {
+      verdict = "OVER BUDGET";
+      all_ok = false;
+    } else if (call + copy > per_line * lookahead) {
+      verdict = "CALL TOO LONG";
+      all_ok = false;
+    } else if (load > 0.9) {
+      verdict = "marginal";
+    } else {
+      verdict = "ok";
+    }
+
+    std::printf("%-4u %-16s %6u %6u %8.0f %6u %8.0f %5.0f%%  %s%s\n",
+                i, m.name, b.lines, pixels, call, lines_per_call,
+                per_line_cost, load * 100, verdict,
+                m.measured ? "" : " (estimated cost)");
+  }
+
+  if (total_lines < visible) {
+    std::printf("\nNote: bands cover %u of %u lines; the rest are blank.\n",
+                total_lines, visible);
+  } else if (total_lines > visible) {
+    std::printf("\nNote: bands cover %u lines, but only %u are visible.\n",
+                total_lines, visible);
+  }
+
+  return all_ok ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/*
+ * Host tool: solves a display mode for the STM32F4 and prints the result as a
+ * Timing initializer, ready to paste into an application or timing.cc.
+ *
+ * Usage:
+ *   solve_timing PCLK_HZ  HACT HFP HSYNC HBP HPOL  VACT VFP VSYNC VBP VPOL
+ *                [CRYSTAL_HZ [MAX_CPU_HZ [MAX_ERROR_PPM]]]
+ *
+ * Polarities are + or -.  For example, VESA 800x600@60:
+ *   solve_timing 40000000  800 40 128 88 +  600 1 4 23 +
+ *
+ * Build with any C++14 host compiler, with the parent of this repository and
+ * etl on the include path; only headers are needed.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "vga/timing_solver.h"
+
+using vga::ModeDescription;
+using vga::SolverLimits;
+using vga::Timing;
+
+static Timing::Polarity parse_polarity(char const *s) {
+  return std::strcmp(s, "-") == 0 ? Timing::Polarity::negative
+                                  : Timing::Polarity::positive;
+}
+
+static char const *polarity_name(Timing::Polarity p) {
+  return p == Timing::Polarity::negative ? "negative" : "positive";
+}
+
+int main(int argc, char **argv) {
+  if (argc < 12 || argc > 15) {
+    std::fprintf(stderr,
+        "usage: %s PCLK_HZ  HACT HFP HSYNC HBP HPOL  VACT VFP VSYNC VBP VPOL\n"
+        "       [CRYSTAL_HZ [MAX_CPU_HZ [MAX_ERROR_PPM]]]\n",
+        argv[0]);
+    return 2;
+  }
+
+  auto num = [&](int i) { return unsigned(std::strtoul(argv[i], nullptr, 0)); };
+
+  ModeDescription mode = {
+    num(1),
+    std::uint16_t(num(2)), std::uint16_t(num(3)),
+    std::uint16_t(num(4)), std::uint16_t(num(5)),
+    parse_polarity(argv[6]),
+    std::uint16_t(num(7)), std::uint16_t(num(8)),
+    std::uint16_t(num(9)), std::uint16_t(num(10)),
+    parse_polarity(argv[11]),
+  };
+
+  SolverLimits limits;
+  if (argc > 12) limits.crystal_hz = num(12);
+  if (argc > 13) limits.max_cpu_hz = num(13);
+  if (argc > 14) limits.max_error_ppm = num(14);
+
+  auto s = vga::solve_timing(mode, limits);
+  if (!s.found) {
+    std::fprintf(stderr, "no solution within %u ppm at up to %u Hz\n",
+                 limits.max_error_ppm, limits.max_cpu_hz);
+    return 1;
+  }
+
+  auto const &t = s.timing;
+  auto const &c = t.clock_config;
+  std::printf(
+      "// %u Hz CPU, %u cycles/pixel, pixel clock error %u ppm\n"
+      "Timing const timing = {\n"
+      "  .clock_config = {\n"
+      "    .crystal_hz = %u,\n"
+      "    .crystal_divisor = %u,\n"
+      "    .vco_multiplier = %u,\n"
+      "    .general_divisor = %u,\n"
+      "    .pll48_divisor = %u,\n"
+      "    .ahb_divisor = %u,\n"
+      "    .apb1_divisor = %u,\n"
+      "    .apb2_divisor = %u,\n"
+      "\n"
+      "    .flash_latency = %u,\n"
+      "  },\n"
+      "\n"
+      "  .cycles_per_pixel = %u,\n"
+      "\n"
+      "  .line_pixels       = %u,\n"
+      "  .sync_pixels       = %u,\n"
+      "  .back_porch_pixels = %u,\n"
+      "  .video_lead        = %u,\n"
+      "  .video_pixels      = %u,\n"
+      "  .hsync_polarity    = Timing::Polarity::%s,\n"
+      "\n"
+      "  .vsync_start_line = %u,\n"
+      "  .vsync_end_line   = %u,\n"
+      "  .video_start_line = %u,\n"
+      "  .video_end_line   = %u,\n"
+      "  .vsync_polarity   = Timing::Polarity::%s,\n"
+      "};\n",
+      s.cpu_hz, unsigned(t.cycles_per_pixel), s.error_ppm,
+      unsigned(c.crystal_hz), unsigned(c.crystal_divisor),
+      unsigned(c.vco_multiplier), unsigned(c.general_divisor),
+      unsigned(c.pll48_divisor), unsigned(c.ahb_divisor),
+      unsigned(c.apb1_divisor), unsigned(c.apb2_divisor),
+      unsigned(c.flash_latency),
+      unsigned(t.cycles_per_pixel),
+      unsigned(t.line_pixels), unsigned(t.sync_pixels),
+      unsigned(t.back_porch_pixels), unsigned(t.video_lead),
+      unsigned(t.video_pixels), polarity_name(t.hsync_polarity),
+      unsigned(t.vsync_start_line), unsigned(t.vsync_end_line),
+      unsigned(t.video_start_line), unsigned(t.video_end_line),
+      polarity_name(t.vsync_polarity));
+  return 0;
+}
@@ -1,7 +1,5 @@
 #include "vga/vga.h"
 
-#include <atomic>
-#include <cstddef>
 #include <cstdint>
 
 #include "etl/assert.h"
@@ -28,13 +26,11 @@
 #include "etl/stm32f4xx/syscfg.h"
 
 #include "vga/arena.h"
-#include "vga/copy_words.h"
+#include "vga/profile.h"
 #include "vga/rasterizer.h"
+#include "vga/scan.h"
 #include "vga/timing.h"
 
-using std::size_t;
-
-using etl::armv7m::Byte;
 using etl::armv7m::HalfWord;
 using etl::armv7m::scb;
 using etl::armv7m::Scb;
@@ -59,7 +55,6 @@ using etl::stm32f4xx::tim1;
 using etl::stm32f4xx::tim3;
 using etl::stm32f4xx::tim4;
 
-#define IN_SCAN_RAM ETL_SECTION(".vga_scan_ram")
 #define IN_LOCAL_RAM ETL_SECTION(".vga_local_ram")
 
 #define RAM_CODE ETL_SECTION(".ramcode")
@@ -71,17 +66,17 @@ namespace vga {
  */
 
 static constexpr unsigned
-  // Used to adjust size of scan_buffer.
-  max_pixels_per_line = 800,
   // Fudge factor: shifts timer-initiated DRQ back in time by this many cycles,
   // to delay DRQ until DMA has started.
   drq_shift_cycles = 2,
   // Fudge factor: how long the shock absorber IRQ should lead the actual start
   // of video IRQ, in cycles.
-  shock_absorber_shift_cycles = 20,
-  // Amount of pad to place on either side of the working buffer, so that lazy
-  // rasterizers can scribble slightly outside the lines -- in words.
-  extra_pad_words = 4;
+  shock_absorber_shift_cycles = 20;
+
+// The interrupt that runs the application's hblank hook.  EAV pends it by
+// software; the driver owns DMA2 stream 5, and never enables the stream's own
+// interrupts, so the vector is otherwise idle.
+static constexpr Interrupt hblank_irq = Interrupt::dma2_stream5;
 
 // Common fields used in scanout DMA transfer settings.
 static constexpr auto dma_xfer_common = Dma::Stream::cr_value_t()
@@ -96,101 +91,16 @@ static constexpr auto dma_xfer_common = Dma::Stream::cr_value_t()
  * Driver state.
  */
 
-// A copy of the current Timing, held in RAM for fast access.
-static Timing current_timing;
-
-// [0, current_mode.video_end_line).  Updated at front porch interrupt.
-static unsigned volatile current_line;
-
-/*
- * The vertical timing state.  This is a Gray code and the bits have meaning.
- * See the inspector functions below.
- */
-enum class State {
-  blank     = 0b00,
-  starting  = 0b01,
-  active    = 0b11,
-  finishing = 0b10,
-};
-
-// Should we be producing a video signal?
-inline bool is_displayed_state(State s) {
-  return static_cast<unsigned>(s) & 0b10;
-}
-
-// Should we be rendering a scanline?
-inline bool is_rendered_state(State s) {
-  return static_cast<unsigned>(s) & 0b01;
-}
-
-// Finally, the actual variable.
-static State volatile state;
-
-// This is the DMA source for scan-out, copied from the working buffer during
-// pend_sv.  It must be located in DMA-capable RAM, and is aligned to allow for
-// word-sized DMA reads.
-//
-// It contains an extra word's worth of pixels to ensure that we can follow
-// every line with an extra transfer to blank the outputs.  The extra pixels
-// are blanked after the rasterizer returns.
-alignas(Word) IN_SCAN_RAM
-static Pixel scan_buffer[max_pixels_per_line + sizeof(Word)];
-
-// This is the working buffer, the target of the Rasterizer.  Its contents will
-// be copied to the scan_buffer during hblank if needed.  It need not be in
-// DMA-capable RAM.
-//
-// It's aligned so we can use a high-speed word copy routine.
-//
-// It has invisible padding at either end because it makes certain tile
-// scrolling algorithms simpler to implement if they need not color precisely
-// within the lines.
-alignas(Word) IN_LOCAL_RAM
-static struct {
-  Word left_pad[extra_pad_words];
-  Pixel buffer[max_pixels_per_line];
-  Word right_pad[extra_pad_words];
-} working;
-
-// A description of the contents of the working buffer, produced by the last
-// Rasterizer that was applied.  This is used to adjust the output timings.
-static Rasterizer::RasterInfo working_buffer_shape;
-
-// When a Rasterizer completes and updates the working buffer, we set this
-// flag.  This triggers a copy into the scan buffer at next hblank, at which
-// time the flag is cleared.  The copy is conditional because it isn't always
-// necessary, e.g. in rasterizer that use line-doubling, so we can save some
-// resources by eliding it.
-//
-// Since this is produced and consumed by interrupts running at a single
-// priority, it need not be volatile or atomic.
-static bool scan_buffer_needs_update;
+using scan::current_timing;
+using scan::is_displayed_state;
 
 // A pre-built control register word to be used to start the next DMA transfer.
-// This is set up during hblank based on the working_buffer_shape, and consumed
+// This is set up during hblank based on the scan_buffer_shape, and consumed
 // at start of active video.
 static Dma::Stream::cr_value_t next_dma_xfer;
 IN_LOCAL_RAM
 static bool next_use_timer;
 
-// The head of the linked list of Rasterizer bands.
-static Band const *band_list_head;
-
-// A copy of the band we're currently processing.  We copy for several reasons:
-// - So that the application may keep its Bands in Flash without a latency
-//   penalty on the driver.
-// - So that we may mutate it, decrementing the line count.
-// - So that the application may rewrite its Bands once rendering starts.
-static Band current_band;
-
-// A semaphore used to indicate, to the application, when the driver has
-// begun processing the most recently configured band list.  Because the
-// driver maintains a copy of a Band, and this copy contains a pointer, it
-// is not safe to deallocate or repurpose a list of Bands while the driver
-// may be using them.  Instead, clear_band_list does it safely using this
-// semaphore.
-static std::atomic<bool> band_list_taken{false};
-
 
 /*******************************************************************************
  * Driver API.
@@ -230,13 +140,16 @@ void init() {
   // Configure our interrupt priorities.  The scheme is:
   //  TIM4 (horizontal) gets highest priority.
   //  TIM3 (shock absorber) is set just lower.
-  //  PendSV (rendering, user code) is lowest.
+  //  The hblank hook (user code) is next, so it can't delay the above.
+  //  PendSV (rendering) is lowest.
   // We could fit other stuff into the gaps later.
   // Note that PendSV is set using ARMv7-M priorities (0-255) and the others are
   // set using narrower SoC priorities (0-15).  This is a bit ugly.
   set_irq_priority(Interrupt::tim4, 0);
   set_irq_priority(Interrupt::tim3, 1);
+  set_irq_priority(hblank_irq, 2);
   scb.set_exception_priority(etl::armv7m::Exception::pend_sv, 0xFF);
+  enable_irq(hblank_irq);
 
   // Halt all our timers on debug.
   dbg.write_dbgmcu_apb1_fz(dbg.read_dbgmcu_apb1_fz()
@@ -253,8 +166,7 @@ void init() {
                   .with_icen(true)
                   .with_prften(true));
 
-  band_list_head = nullptr;
-  band_list_taken = false;
+  configure_band_list(nullptr);
 
   sync_off();
   video_off();
@@ -399,31 +311,10 @@ void configure_timing(Timing const &timing) {
     case Timing::Polarity::negative: gpiob.set  (1 << 7); break;
   }
 
-  // Scribble over working buffer to help catch bugs.
-  for (size_t i = 0; i < sizeof(working.buffer); i += 2) {
-    working.buffer[i] = 0xFF;
-    working.buffer[i + 1] = 0x00;
-  }
-
-  // Blank the final word of the scan buffer.
-  for (unsigned i = 0; i < sizeof(Word); ++i) {
-    scan_buffer[timing.video_pixels + i] = 0;
-  }
-
   // Set up global state.
-  current_line = 0;
-  current_timing = timing;
-  state = State::blank;
-  working_buffer_shape = {
-    .offset = 0,
-    .length = 0,
-    .cycles_per_pixel = timing.cycles_per_pixel,
-    .repeat_lines = 0,
-  };
+  scan::reset(timing);
   next_use_timer = false;
 
-  scan_buffer_needs_update = false;
-
   // Start TIM3, which starts TIM4.
   enable_irq(Interrupt::tim3);
   enable_irq(Interrupt::tim4);
@@ -432,24 +323,15 @@ void configure_timing(Timing const &timing) {
   sync_on();
 }
 
-void configure_band_list(Band const *head) {
-  band_list_head = head;
-  band_list_taken = false;
-}
-
 void clear_band_list() {
   configure_band_list(nullptr);
-  while (!band_list_taken) etl::armv7m::wait_for_interrupt();
+  while (!scan::band_list_taken) etl::armv7m::wait_for_interrupt();
 }
 
 void wait_for_vblank() {
   while (!in_vblank()) etl::armv7m::wait_for_interrupt();
 }
 
-bool in_vblank() {
-  return current_line < current_timing.video_start_line;
-}
-
 void sync_to_vblank() {
   while (in_vblank()) etl::armv7m::wait_for_interrupt();
   wait_for_vblank();
@@ -460,11 +342,13 @@ void sync_to_vblank() {
  * namespace vga toward the end of the file.
  */
 
+static void prepare_for_scanout();
+
 RAM_CODE
 static void start_of_active_video() {
   // The start-of-active-video (SAV) event is only significant during visible
   // lines.
-  if (ETL_UNLIKELY(!is_displayed_state(state))) return;
+  if (ETL_UNLIKELY(!is_displayed_state(scan::state))) return;
 
   // Clear stream 5 flags (hifcr is a write-1-to-clear register).
   dma2.write_hifcr(Dma::hifcr_value_t()
@@ -491,105 +375,62 @@ static void end_of_active_video() {
       .with_urs(true)
       .with_cen(false));
 
-  // Apply timing changes requested by the last rasterizer.
+  // We've finished this line; figure out what to do on the next one.
+  bool vsync_edge = scan::end_of_line();
+
+  // If the next line is visible, get its pixels into place and prepare for
+  // scanout.  This is done here, rather than in PendSV, so that it can
+  // preempt a rasterizer that's running long -- the lookahead queue exists so
+  // that it can.
+  //
+  // This writes to the scanout buffer *and* accesses AHB/APB peripherals, so
+  // it *cannot* run concurrently with scanout -- hence hblank.
+  //
+  // That makes the scan buffer copy (about 0.27 cycles per pixel, or ~220
+  // cycles at 800 pixels) the longest thing we do at priority 0.  It's fine
+  // here: the only other priority 0 event is SAV, which can't be due until
+  // the copy is done anyway, and TIM3 is only there to idle the bus before
+  // SAV, which the copy delays but never overruns.  Builds that need the time
+  // back can define VGA_ZERO_COPY_SCANOUT (see scan.h).
+  if (ETL_LIKELY(is_displayed_state(scan::state))) {
+    auto start = profile_clock();
+    scan::update_scan_buffer();
+    profile_record(ProfilePhase::update_scan_buffer,
+                   scan::scan_band_index, start);
+
+    start = profile_clock();
+    prepare_for_scanout();
+    profile_record(ProfilePhase::prepare_for_scanout,
+                   scan::scan_band_index, start);
+  }
+
+  // Apply timing changes requested by the rasterizer of the next line.
   tim4.write_ccr2(current_timing.sync_pixels
                   + current_timing.back_porch_pixels - current_timing.video_lead
-                  + working_buffer_shape.offset);
+                  + scan::scan_buffer_shape.offset);
 
-  // Pend a PendSV to process hblank tasks.
+  // Pend the application's hblank hook, and a PendSV to rasterize.  The hook
+  // gets an interrupt of its own, between us and PendSV: in PendSV it would
+  // be skipped whenever rasterize_ahead ran across several lines (the
+  // PendSVs we pend meanwhile coalesce into one), and here it would hold off
+  // SAV and the shock absorber.
+  //
+  // (This writes the NVIC's Software Trigger Interrupt Register.)
+  *reinterpret_cast<Word volatile *>(0xE000EF00) =
+      static_cast<Word>(hblank_irq);
   scb.write_icsr(Scb::icsr_value_t().with_pendsvset(true));
 
-  // We've finished this line; figure out what to do on the next one.
-  unsigned next_line = current_line + 1;
-
-  if (next_line == current_timing.vsync_start_line
-      || next_line == current_timing.vsync_end_line) {
+  if (vsync_edge) {
     // Either edge of vsync pulse.
     gpiob.toggle(Gpio::p7);
-  } else if (next_line == uint16_t(current_timing.video_start_line - 1)) {
-    // We're one line before scanout begins -- need to start rasterizing.
-    state = State::starting;
-    if (band_list_head) {
-      current_band = *band_list_head;
-    } else {
-      current_band = { nullptr, 0, nullptr };
-    }
-    band_list_taken = true;
-  } else if (next_line == current_timing.video_start_line) {
-    // Time to start output.  This will cause PendSV to copy rasterization
-    // output into place for scanout, and the next SAV will start DMA.
-    state = State::active;
-  } else if (next_line == uint16_t(current_timing.video_end_line - 1)) {
-    // For the final line, suppress rasterization but continue preparing
-    // previously rasterized data for scanout, and continue starting DMA in
-    // SAV.
-    state = State::finishing;
-  } else if (next_line == uint16_t(current_timing.video_end_line)) {
-    // All done!  Suppress all scanout activity.
-    state = State::blank;
-    next_line = 0;
   }
-
-  current_line = next_line;
 }
 
-void default_hblank_interrupt();  // decl hack
-RAM_CODE void default_hblank_interrupt() {}
-
 
 /*******************************************************************************
- * Rasterization interface.  These are implementation factors of the PendSV
- * ISR.
+ * Scanout interface.  This is an implementation factor of the EAV ISR.
  */
 
-/*
- * Advances the current rasterizer band, possibly switching it for the next if
- * we've reached the end.  The 'edge' parameter is used only in the recursive
- * case.  (It would not appear at all if this language had nested functions.)
- */
-RAM_CODE
-static bool advance_rasterizer_band(bool edge = false) {
-  if (current_band.line_count) {
-    --current_band.line_count;
-    return edge;
-  }
-
-  if (current_band.next) {
-    current_band = *current_band.next;
-    return advance_rasterizer_band(true);
-  } else {
-    current_band = { nullptr, 0, nullptr };
-    return edge;
-  }
-}
-
-/*
- * Transfers the contents of the working buffer into the scan buffer, if
- * necessary.
- */
-RAM_CODE
-static void update_scan_buffer() {
-  if (scan_buffer_needs_update) {
-    // Flip working_buffer into scan_buffer.  We know its contents are ready
-    // because of the scan_buffer_needs_update flag.  Note that the flag may
-    // not have been set, even in a displayed state, if we're repeating a
-    // line.
-    //
-    // Note that GCC can't see that we've aligned the buffers correctly, so we
-    // have to do a multi-cast dance. :-/
-    copy_words(
-        reinterpret_cast<Word const *>(
-          static_cast<void *>(working.buffer)),
-        reinterpret_cast<Word *>(
-          static_cast<void *>(scan_buffer)),
-        (working_buffer_shape.length + sizeof(Word) - 1) / sizeof(Word));
-    for (unsigned i = 0; i < sizeof(Word); ++i) {
-      scan_buffer[working_buffer_shape.length + i] = 0;
-    }
-    scan_buffer_needs_update = false;
-  }
-}
-
 /*
  * Prepares a configuration for the DMA stream and configures the horizontal
  * timer, if it's relevant to this mode.
@@ -599,10 +440,21 @@ static void prepare_for_scanout() {
   auto & st = dma2.stream5;
   st.write_cr(st.read_cr().with_en(false));
 
-  if (working_buffer_shape.cycles_per_pixel > 4) {
+  auto plan = scan::plan_scanout();
+
+  Dma::Stream::TransferSize size;
+  switch (plan.transfer_bytes) {
+    case sizeof(Word):     size = Dma::Stream::TransferSize::word; break;
+    case sizeof(HalfWord): size = Dma::Stream::TransferSize::half_word; break;
+    default:               size = Dma::Stream::TransferSize::byte; break;
+  }
+
+  st.write_ndtr(plan.transfer_count);
+
+  if (plan.use_timer) {
     // Adjust reload frequency of TIM1 to accomodate desired pixel clock.
     // (ARR value is period - 1.)
-    tim1.write_arr(working_buffer_shape.cycles_per_pixel - 1);
+    tim1.write_arr(plan.cycles_per_pixel - 1);
     // Force an update to reset the timer state.
     tim1.write_egr(AdvTimer::egr_value_t().with_ug(true));
     // Configure the timer as *almost* ready to produce a DRQ, less a small
@@ -612,32 +464,11 @@ static void prepare_for_scanout() {
     tim1.write_sr(0);
 
     st.write_par(0x40021015);  // High byte of GPIOE ODR (hack hack)
-    st.write_m0ar(reinterpret_cast<Word>(&scan_buffer));
-
-    // The number of bytes read must exactly match the number of bytes written,
-    // or the DMA controller will freak out.  Thus, we must adapt the transfer
-    // size to the number of bytes transferred.
-    Dma::Stream::TransferSize msize;
-    switch (working_buffer_shape.length & 3) {
-      case 0:
-        msize = Dma::Stream::TransferSize::word;
-        st.write_ndtr(working_buffer_shape.length + sizeof(Word));
-        break;
-
-      case 2:
-        msize = Dma::Stream::TransferSize::half_word;
-        st.write_ndtr(working_buffer_shape.length + sizeof(HalfWord));
-        break;
-
-      default:
-        msize = Dma::Stream::TransferSize::byte;
-        st.write_ndtr(working_buffer_shape.length + sizeof(Byte));
-        break;
-    }
+    st.write_m0ar(reinterpret_cast<Word>(scan::scan_source));
 
     next_dma_xfer = dma_xfer_common
         .with_dir(Dma::Stream::cr_value_t::dir_t::memory_to_peripheral)
-        .with_msize(msize)
+        .with_msize(size)
         .with_minc(true)
         .with_psize(Dma::Stream::TransferSize::byte)
         .with_pinc(false);
@@ -646,30 +477,12 @@ static void prepare_for_scanout() {
   } else {
     // Note that we're using memory as the peripheral side.
     // This DMA controller is a little odd.
-    st.write_par(reinterpret_cast<Word>(&scan_buffer));
+    st.write_par(reinterpret_cast<Word>(scan::scan_source));
     st.write_m0ar(0x40021015);  // High byte of GPIOE ODR (hack hack)
 
-    Dma::Stream::TransferSize psize;
-    switch (working_buffer_shape.length & 3) {
-      case 0:
-        psize = Dma::Stream::TransferSize::word;
-        st.write_ndtr(working_buffer_shape.length / sizeof(Word) + 1);
-        break;
-
-      case 2:
-        psize = Dma::Stream::TransferSize::half_word;
-        st.write_ndtr(working_buffer_shape.length / sizeof(HalfWord) + 1);
-        break;
-
-      default:
-        psize = Dma::Stream::TransferSize::byte;
-        st.write_ndtr(working_buffer_shape.length / sizeof(Byte) + 1);
-        break;
-    }
-
     next_dma_xfer = dma_xfer_common
         .with_dir(Dma::Stream::cr_value_t::dir_t::memory_to_memory)
-        .with_psize(psize)
+        .with_psize(size)
         .with_pinc(true)
         .with_msize(Dma::Stream::TransferSize::byte)
         .with_minc(false);
@@ -677,50 +490,13 @@ static void prepare_for_scanout() {
   }
 }
 
-/*
- * Generates pixels for the *next* line, not the currently displaying one.
- */
-RAM_CODE
-static void rasterize_next_line() {
-  auto const &timing = current_timing;
-  auto next_line = current_line + 1;
-  auto visible_line = next_line - timing.video_start_line;
-
-  bool band_edge = advance_rasterizer_band();
-  if (working_buffer_shape.repeat_lines == 0 || band_edge) {
-    // Either the last rasterizer has run out of its repeat count and wants
-    // to be called again, or we've reached a band edge and are going to call
-    // the new rasterizer no matter what the old one wished.
-    auto r = current_band.rasterizer;
-    if (r) {
-      working_buffer_shape = r->rasterize(current_timing.cycles_per_pixel,
-                                          visible_line,
-                                          working.buffer);
-      // Request a rewrite of the scanout buffer during next hblank.
-    } else {
-      working_buffer_shape = {
-        .offset = 0,
-        .length = 0,
-        .cycles_per_pixel = current_timing.cycles_per_pixel,
-        .repeat_lines = 0,
-      };
-    }
-    scan_buffer_needs_update = true;
-  } else {  // repeat_lines > 0, not band_edge
-    --working_buffer_shape.repeat_lines;
-  }
-}
-
 }  // namespace vga
 
 
 /*******************************************************************************
- * ISRs and user interrupt hook
+ * ISRs
  */
 
-void vga_hblank_interrupt()
-  __attribute__((weak, alias("_ZN3vga24default_hblank_interruptEv")));
-
 RAM_CODE void etl_stm32f4xx_tim3_handler() {
   // We access this APB2 timer through the bridge on AHB1.  This implies
   // both wait states and resource conflicts with scanout.  Get done fast.
@@ -750,31 +526,22 @@ RAM_CODE void etl_stm32f4xx_tim4_handler() {
   }
 }
 
+RAM_CODE void etl_stm32f4xx_dma2_stream5_handler() {
+  // Pended by EAV, once per line.  TIM3 and TIM4 preempt us as needed.
+  vga_hblank_interrupt();
+}
+
 RAM_CODE
 void etl_armv7m_pend_sv_handler() {
   // PendSV event is triggered shortly after EAV to process lower-priority
-  // tasks.
-
-  // First, prepare for scanout from SAV on this line.  This has two purposes:
-  // it frees up the rasterization target buffer so that we can overwrite it,
-  // and it applies pixel timing choices from the *last* rasterizer run to the
-  // scanout machine so that we can replace them as well.
-  //
-  // This writes to the scanout buffer *and* accesses AHB/APB peripherals, so it
-  // *cannot* run concurrently with scanout -- so we do it first, during hblank.
-  if (ETL_LIKELY(is_displayed_state(vga::state))) {
-    vga::update_scan_buffer();
-    vga::prepare_for_scanout();
-  }
-
-  // Allow the application to do additional work during what's left of hblank.
-  vga_hblank_interrupt();
-
-  // Second, rasterize the *next* line, if there's a useful next line.
-  // Rasterization can take a while, and may run concurrently with scanout.
-  // As a result, we just stash our results in places where the *next* PendSV
-  // will find and apply them.
-  if (ETL_LIKELY(is_rendered_state(vga::state))) {
-    vga::rasterize_next_line();
+  // tasks.  By the time it runs, EAV has already prepared this line for
+  // scanout, and the application's hblank hook has run.
+
+  // Rasterize ahead, if there's a useful next line.  Rasterization can take a
+  // while, and may run concurrently with scanout -- even across several lines,
+  // as long as earlier lines left enough in the queue.  EAV preempts us to
+  // take lines from the queue as they're needed.
+  if (ETL_LIKELY(vga::scan::is_rendered_state(vga::scan::state))) {
+    vga::scan::rasterize_ahead();
   }
 }
@@ -8,6 +8,7 @@ namespace vga {
 // Forward declarations of types used below.
 struct Timing;      // see: timing.h
 class Rasterizer;   // see: rasterizer.h
+struct Effect;      // see: effect.h
 
 
 /*******************************************************************************
@@ -27,6 +28,10 @@ struct Band {
   Rasterizer *rasterizer;   // Rasterizer that handles this band.
   unsigned line_count;      // Number of scanlines included.
   Band const *next;         // Where to go from here.
+
+  // Optional raster effects, sorted by line.  See effect.h.
+  Effect const *effects = nullptr;
+  unsigned effect_count = 0;
 };
 
 
@@ -59,6 +64,22 @@ void init();
  */
 void configure_band_list(Band const *head);
 
+/*
+ * Like configure_band_list, but the driver compiles the list into a table of
+ * its own, in local RAM, before returning.  Rather than chasing Band pointers
+ * between bands, the driver then just steps through the table.
+ *
+ * Because the driver keeps no pointers to the Bands, the application may alter
+ * or deallocate them as soon as this returns; changes won't be seen until the
+ * list is configured again.  (The Rasterizers and Effects must still outlive
+ * their use, as with configure_band_list.)  The new list takes effect at the
+ * start of the next frame.
+ *
+ * Returns false, leaving the band list unchanged, if the list contains more
+ * than 16 Bands.
+ */
+bool configure_compiled_band_list(Band const *head);
+
 /*
  * Switches the driver band list for an empty list and synchronizes with the
  * driver to ensure that the change has been made.  This is useful to disconnect
@@ -66,6 +87,35 @@ void configure_band_list(Band const *head);
  */
 void clear_band_list();
 
+/*
+ * What the driver does when a line isn't rasterized in time for scanout --
+ * that is, when the rasterizer has fallen behind by more than the lookahead
+ * queue can absorb.
+ */
+enum class OverrunPolicy {
+  // Show the most recent line that was ready, again.  Usually invisible.
+  repeat_line,
+  // Show a line of solid border color.
+  border,
+  // Repeat the line, and abandon rasterization of the rest of the band that
+  // overran, repeating its last line to the end of the band.  This gives the
+  // rasterizer for the next band a clean start.
+  skip_band,
+};
+
+/*
+ * Selects the overrun policy.  The default is repeat_line.  The border color
+ * is used only by OverrunPolicy::border.
+ */
+void configure_overrun_policy(OverrunPolicy, Pixel border_color = 0);
+
+/*
+ * Returns the number of lines, since init, that weren't ready for scanout in
+ * time -- including lines abandoned under OverrunPolicy::skip_band.  This
+ * counts up regardless of policy, and wraps on overflow.
+ */
+unsigned get_overrun_count();
+
 /*
  * Configures vertical and horizontal timing according to the parameters
  * contained in the given Timing struct.  Note that this will also change the
@@ -137,6 +187,21 @@ void sync_on();
 
 /*
  * Applications can implement this function to receive a callback during hblank.
+ *
+ * It's called once per line, including blanked lines, from an interrupt the
+ * driver pends at end of active video, after the next line has been prepared
+ * for scanout.  That interrupt is below the driver's horizontal timing
+ * interrupts and above rasterization.  So:
+ * - It can't disturb the video timing, but if it's still running at start of
+ *   active video it contends with scanout for the bus.  Keep it short, and do
+ *   anything longer in thread mode.  If it takes longer than a whole line,
+ *   calls for the lines it overlaps are coalesced.
+ * - It preempts rasterization, which may be running several lines ahead of
+ *   scanout.  Changes it makes to rasterizer state may therefore show up a few
+ *   lines late; use Effects (effect.h) for changes tied to a specific line.
+ *
+ * The driver uses the DMA2 stream 5 interrupt vector for this, so the
+ * application must not.
  */
 extern void vga_hblank_interrupt();
 